@@ -186,10 +186,26 @@ static gint _query_metainfo(const lutil_query_properties_t qps,
                             quvi_http_metainfo_t *qmi,
                             const quvi_media_t qm)
 {
+  struct lutil_curl_stats_s s;
+  gint r;
+
   *qmi = NULL;
   if (opts.dump.query_metainfo == FALSE)
     return (EXIT_SUCCESS);
-  return (lutil_query_metainfo(qps->q, qm, qmi, qps->xperr));
+
+  r = lutil_query_metainfo(qps->q, qm, qmi, qps->xperr);
+
+  if (r == EXIT_SUCCESS)
+    lutil_curl_share_account(lutil_curl_handle_from(qps->q));
+
+  /* Append the timing of the HTTP HEAD request to --stats-file. */
+  if (r == EXIT_SUCCESS && opts.core.stats_file != NULL)
+    {
+      lutil_curl_stats_from(lutil_curl_handle_from(qps->q), &s);
+      r = lutil_stats_write(opts.core.stats_file, "head", NULL, &s, NULL,
+                            qps->xperr);
+    }
+  return (r);
 }
 
 static void _foreach_subtitle_url(gpointer p, gpointer userdata,
@@ -256,36 +272,40 @@ static void _foreach_subtitle_url(gpointer p, gpointer userdata,
   if (opts.core.print_subtitles == FALSE)
     {
       const gchar *lang;
-      quvi_subtitle_t l;
+      GSList *l, *curr;
 
-      /* Choose the subtitle, otherwise use the default. */
+      /*
+       * Choose the subtitles, otherwise use the default. Each of the
+       * ';' separated language groups chooses one language.
+       */
 
       lang = (opts.core.subtitle_language != NULL)
              ? opts.core.subtitle_language
              : "default"; /* Assumes nothing matches this in the array. */
 
       qps->exit_status =
-        lutil_choose_subtitle(qps->q, qsub, lang, qps->xperr, &l, TRUE);
+        lutil_choose_subtitles(qps->q, qsub, lang, qps->xperr, &l, TRUE);
 
-      if (qps->exit_status != EXIT_SUCCESS)
-        return;
-
-      qps->exit_status = subtitle_new(qps->q, &h);
-      if (qps->exit_status != EXIT_SUCCESS)
-        return;
+      for (curr=l; curr != NULL && qps->exit_status == EXIT_SUCCESS;
+           curr=g_slist_next(curr))
+        {
+          qps->exit_status = subtitle_new(qps->q, &h);
+          if (qps->exit_status != EXIT_SUCCESS)
+            break;
 
-      qps->exit_status = subtitle_lang_properties(l, h);
-      if (qps->exit_status == EXIT_SUCCESS)
-        qps->exit_status = subtitle_print_buffer(h);
+          qps->exit_status = subtitle_lang_properties(curr->data, h);
+          if (qps->exit_status == EXIT_SUCCESS)
+            qps->exit_status = subtitle_print_buffer(h);
 
-      subtitle_free(h);
+          subtitle_free(h);
+        }
+      g_slist_free(l);
     }
   else
     qps->exit_status = subtitles_available(qps->q, qsub);
 }
 
-static void _foreach_media_url(gpointer p, gpointer userdata,
-                               const gchar *url)
+static void _dump_media(gpointer p, gpointer userdata, const gchar *url)
 {
   lprint_cb_media_streams_available media_streams_available;
   lprint_cb_media_stream_properties media_stream_properties;
@@ -360,7 +380,17 @@ static void _foreach_media_url(gpointer p, gpointer userdata,
 
       /* Choose the stream, otherwise use the default. */
 
-      if (opts.core.stream != NULL)
+      if (qps->stream_policy != NULL)
+        {
+          qps->exit_status = lutil_policy_choose(qps->stream_policy,
+                                                 qps->q, qm, qps->xperr);
+          if (qps->exit_status != EXIT_SUCCESS)
+            {
+              media_free(h);
+              return;
+            }
+        }
+      else if (opts.core.stream != NULL)
         {
           qps->exit_status = lutil_choose_stream(qps->q, qm, opts.core.stream,
                                                  qps->xperr);
@@ -383,6 +413,8 @@ static void _foreach_media_url(gpointer p, gpointer userdata,
 
       /* Dump the properties. */
 
+      lutil_trace_begin("quvi", "print", url);
+
       qps->exit_status = media_properties(h);
       if (qps->exit_status == EXIT_SUCCESS)
         {
@@ -391,6 +423,8 @@ static void _foreach_media_url(gpointer p, gpointer userdata,
             qps->exit_status = media_print_buffer(h);
         }
 
+      lutil_trace_end("quvi", "print");
+
       if (qps->exit_status == EXIT_SUCCESS)
         qps->exit_status = _exec_cmd(qps, qmi, qm);
 
@@ -401,6 +435,21 @@ static void _foreach_media_url(gpointer p, gpointer userdata,
     qps->exit_status = media_streams_available(qps->q, qm);
 }
 
+static void _foreach_media_url(gpointer p, gpointer userdata,
+                               const gchar *url)
+{
+  lutil_query_properties_t qps = (lutil_query_properties_t) p;
+
+  if (qps->exit_status != EXIT_SUCCESS)
+    return;
+
+  _dump_media(p, userdata, url);
+
+  lutil_metrics_add(UTIL_METRIC_URLS_PROCESSED, url, 1);
+  if (qps->exit_status != EXIT_SUCCESS)
+    lutil_metrics_add(UTIL_METRIC_URLS_FAILED, url, 1);
+}
+
 static gint _cleanup(const gint r)
 {
   sigwinch_reset(&sao);
@@ -409,22 +458,12 @@ static gint _cleanup(const gint r)
   return (r);
 }
 
-gint cmd_dump(gint argc, gchar **argv)
+/* Query and print the properties of the URLs in the parsed input. */
+gint cmd_dump_run(gpointer q, gpointer p)
 {
   lutil_cb_printerr xperr;
   struct setup_query_s sq;
-
-  if (setup_opts(argc, argv, &lopts) != EXIT_SUCCESS)
-    return (EXIT_FAILURE);
-
-  if (lutil_parse_input(&linput, (const gchar**) opts.rargs) != EXIT_SUCCESS)
-    return (EXIT_FAILURE);
-
-  if (setup_quvi(&q) != EXIT_SUCCESS)
-    {
-      linput_free(&linput);
-      return (EXIT_FAILURE);
-    }
+  gint r;
 
   /* Check {media,playlist} URL support. */
 
@@ -453,12 +492,43 @@ gint cmd_dump(gint argc, gchar **argv)
   sq.perr = lutil_print_stderr_unless_quiet;
   sq.xperr = xperr;
 
-  sq.linput = &linput;
+  sq.linput = (linput_t) p;
   sq.q = q;
 
+  /* Per run: serve may run the dump requests concurrently. */
+  if (opts.core.stream_policy != NULL)
+    {
+      sq.stream_policy = lutil_policy_new(opts.core.stream_policy,
+                                          setup_quvi_pool_handle,
+                                          xperr);
+      if (sq.stream_policy == NULL)
+        return (EXIT_FAILURE);
+    }
+
+  r = setup_query(&sq);
+
+  lutil_policy_free(sq.stream_policy);
+
+  return (r);
+}
+
+gint cmd_dump(gint argc, gchar **argv)
+{
+  if (setup_opts(argc, argv, &lopts) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  if (lutil_parse_input(&linput, (const gchar**) opts.rargs) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  if (setup_quvi(&q) != EXIT_SUCCESS)
+    {
+      linput_free(&linput);
+      return (EXIT_FAILURE);
+    }
+
   sigwinch_setup(&saw, &sao);
 
-  return (_cleanup(setup_query(&sq)));
+  return (_cleanup(cmd_dump_run(q, &linput)));
 }
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -36,6 +36,7 @@
 #include "cmd.h"
 
 static struct sigaction saw, sao;
+static struct sigaction sat, sao_int, sao_term;
 static struct linput_s linput;
 static struct lopts_s lopts;
 extern struct opts_s opts;
@@ -43,7 +44,7 @@ static quvi_t q;
 
 static gint _write_subtitle(quvi_subtitle_lang_t ql,
                             quvi_subtitle_export_t qse,
-                            const gchar *mfpath,
+                            const gchar *mfpath, const gchar *ext,
                             lutil_cb_printerr xperr)
 {
   gchar *fname, *fpath, *tmp;
@@ -56,14 +57,13 @@ static gint _write_subtitle(quvi_subtitle_lang_t ql,
   /*
    * Produce the output fpath for the subtitle file by using the media
    * fpath as a template: replace the media file extension with the
-   * subtitle file extension.
+   * subtitle file extension (ext).
    *
    * The '%x' is being used only to pass the lutil_regex_op_new regular
    * expression validation step. This could be anything matching '%\w'.
    */
 
-  tmp = g_strdup_printf("%%x:s/\\.\\w+$/.%s/",
-                        opts.core.subtitle_export_format);
+  tmp = g_strdup_printf("%%x:s/\\.\\w+$/.%s/", ext);
 
   rx = lutil_regex_op_new(tmp, NULL);
   g_free(tmp);
@@ -176,54 +176,265 @@ static void _dump_languages(quvi_subtitle_t qsub)
   g_free(s);
 }
 
-static gint _copy_subtitle(const gchar *mfpath, const gchar *url,
-                           lutil_cb_printerr xperr)
+/*
+ * The subtitles are queried, selected and exported in a thread of their
+ * own while the media is being transferred, using a quvi_t handle of
+ * their own (see cmd_get_run). The results are written once the media
+ * output fpath is known.
+ *
+ * Each of the ';' separated --subtitle-language groups selects one
+ * language, and each selected language is exported to each of the ','
+ * separated --subtitle-export-format formats, all from the same
+ * quvi_subtitle_t. The exports share the quvi_t and, since libquvi
+ * handles are not thread-safe, run one after another in the thread.
+ */
+
+static quvi_t q_subtitle = NULL;
+
+struct subtitle_export_s
 {
+  quvi_subtitle_export_t qse;
   quvi_subtitle_lang_t ql;
+  gchar *errmsg;
+  gchar *ext;
+};
+
+typedef struct subtitle_export_s *subtitle_export_t;
+
+struct subtitle_job_s
+{
   quvi_subtitle_t qsub;
+  GSList *exports;
+  gboolean found;
+  GThread *thread;
+  gchar *errmsg;
+  gchar *url;
+};
+
+typedef struct subtitle_job_s *subtitle_job_t;
+
+static void _subtitle_quiet_errmsg(const gchar *fmt, ...)
+{
+  /* The errors are reported by _subtitle_job_finish. */
+}
+
+static void _subtitle_export(subtitle_job_t j, quvi_subtitle_lang_t ql,
+                             const gchar *fmt, const gboolean lang_in_ext)
+{
+  subtitle_export_t e;
+  const gchar *s;
+
+  e = g_new0(struct subtitle_export_s, 1);
+  e->ql = ql;
+
+  quvi_subtitle_lang_get(ql, QUVI_SUBTITLE_LANG_PROPERTY_ID, &s);
+
+  e->ext = (lang_in_ext == TRUE)
+           ? g_strdup_printf("%s.%s", s, fmt)
+           : g_strdup(fmt);
+
+  e->qse = quvi_subtitle_export_new(ql, fmt);
+  if (quvi_ok(q_subtitle) == FALSE)
+    {
+      e->errmsg = g_strdup_printf(_("libquvi: while exporting subtitle: %s"),
+                                  quvi_errmsg(q_subtitle));
+    }
+  j->exports = g_slist_prepend(j->exports, e);
+}
+
+static gpointer _subtitle_job_func(gpointer p)
+{
+  gboolean lang_in_ext;
+  GSList *l, *curr;
+  gchar **fmts;
+  gint i, r;
+
+  subtitle_job_t j = (subtitle_job_t) p;
+
+  j->qsub = quvi_subtitle_new(q_subtitle, j->url);
+  if (quvi_ok(q_subtitle) == FALSE)
+    {
+      j->errmsg = g_strdup_printf(_("libquvi: while querying subtitles: %s"),
+                                  quvi_errmsg(q_subtitle));
+      return (NULL);
+    }
+  j->found = TRUE;
+
+  r = lutil_choose_subtitles(q_subtitle, j->qsub,
+                             opts.core.subtitle_language,
+                             _subtitle_quiet_errmsg, &l, FALSE);
+  if (r != EXIT_SUCCESS)
+    {
+      j->errmsg = g_strdup_printf(_("libquvi: while selecting subtitle: %s"),
+                                  quvi_errmsg(q_subtitle));
+      return (NULL);
+    }
+
+  fmts = g_strsplit(opts.core.subtitle_export_format, ",", 0);
+
+  /* Keep the file names as they were, unless more than one language. */
+  lang_in_ext = (g_slist_length(l) >1) ? TRUE:FALSE;
+
+  for (curr=l; curr != NULL; curr=g_slist_next(curr))
+    {
+      for (i=0; fmts[i] != NULL; ++i)
+        {
+          if (strlen(g_strstrip(fmts[i])) >0)
+            _subtitle_export(j, curr->data, fmts[i], lang_in_ext);
+        }
+    }
+  j->exports = g_slist_reverse(j->exports);
+
+  g_slist_free(l);
+  g_strfreev(fmts);
+
+  return (NULL);
+}
+
+/* Start resolving the subtitles, return NULL if none were requested. */
+static subtitle_job_t _subtitle_job_new(const gchar *url)
+{
+  subtitle_job_t j;
+
+  if (q_subtitle == NULL)
+    return (NULL);
+
+  j = g_new0(struct subtitle_job_s, 1);
+  j->url = g_strdup(url);
+
+  j->thread = g_thread_try_new("subtitle", _subtitle_job_func, j, NULL);
+  if (j->thread == NULL)
+    _subtitle_job_func(j); /* Fall back to resolving them here. */
+
+  return (j);
+}
+
+static void _subtitle_export_free(gpointer p, gpointer userdata)
+{
+  subtitle_export_t e = (subtitle_export_t) p;
+
+  quvi_subtitle_export_free(e->qse);
+  g_free(e->errmsg);
+  g_free(e->ext);
+  g_free(e);
+}
+
+static void _subtitle_job_free(subtitle_job_t j)
+{
+  if (j == NULL)
+    return;
+
+  lutil_slist_free_full(j->exports, _subtitle_export_free);
+  quvi_subtitle_free(j->qsub);
+  g_free(j->errmsg);
+  g_free(j->url);
+  g_free(j);
+}
+
+/* Wait for the subtitles, write them next to the media file unless NULL. */
+static gint _subtitle_job_finish(subtitle_job_t j, const gchar *mfpath,
+                                 lutil_cb_printerr xperr)
+{
+  GSList *curr;
   gint r;
 
-  if (opts.core.subtitle_language == NULL)
+  if (j == NULL)
     return (EXIT_SUCCESS);
 
-  qsub = quvi_subtitle_new(q, url);
-  if (quvi_ok(q) == FALSE)
+  if (j->thread != NULL)
+    g_thread_join(j->thread);
+
+  if (mfpath == NULL)
+    return (EXIT_SUCCESS);
+
+  if (j->found == TRUE)
+    _dump_languages(j->qsub);
+
+  if (j->errmsg != NULL)
     {
-      xperr(_("libquvi: while querying subtitles: %s"), quvi_errmsg(q));
+      xperr("%s", j->errmsg);
       return (EXIT_FAILURE);
     }
 
-  _dump_languages(qsub);
-
-  r = lutil_choose_subtitle(q, qsub, opts.core.subtitle_language,
-                            xperr, &ql, FALSE);
-  if (r == EXIT_SUCCESS)
+  if (j->exports == NULL)
     {
-      if (ql != NULL)
-        {
-          quvi_subtitle_export_t qse;
+      g_print(_("skip <transfer>: subtitle extraction\n"));
+      return (EXIT_SUCCESS);
+    }
 
-          qse = quvi_subtitle_export_new(ql, opts.core.subtitle_export_format);
-          if (quvi_ok(q) == TRUE)
-            r = _write_subtitle(ql, qse, mfpath, xperr);
-          else
-            xperr(_("libquvi: while exporting subtitle: %s"), quvi_errmsg(q));
+  r = EXIT_SUCCESS;
+
+  for (curr=j->exports; curr != NULL; curr=g_slist_next(curr))
+    {
+      subtitle_export_t e = (subtitle_export_t) curr->data;
 
-          quvi_subtitle_export_free(qse);
+      if (e->errmsg != NULL)
+        {
+          xperr("%s", e->errmsg);
+          r = EXIT_FAILURE;
+        }
+      else if (_write_subtitle(e->ql, e->qse, mfpath, e->ext,
+                               xperr) != EXIT_SUCCESS)
+        {
+          r = EXIT_FAILURE;
         }
-      else
-        g_print(_("skip <transfer>: subtitle extraction\n"));
     }
-  quvi_subtitle_free(qsub);
-
   return (r);
 }
 
+/*
+ * --schedule: the media URLs (and the media URLs of the playlists) are
+ * collected first, and transferred once the whole input was queried.
+ * With 'size', the content length of each chosen stream is queried
+ * while collecting. Each media URL is resolved again just before its
+ * transfer, as the media stream URLs may expire while in the queue.
+ */
+
+struct job_s
+{
+  gdouble content_length; /* 0 if unknown */
+  gint priority;
+  guint order;
+  gchar *url;
+};
+
+typedef struct job_s *job_t;
+
+static struct
+{
+  GHashTable *priority; /* linput_s url.priority */
+  gboolean by_size;
+  gboolean probe; /* content lengths, for by_size or --check-space */
+  GSList *jobs;
+  guint pos; /* of the current transfer, 1-based */
+  guint len;
+} sched;
+
+static lutilOutputShard _output_shard()
+{
+  if (g_strcmp0(opts.get.output_shard, "hash") ==0)
+    return (UTIL_OUTPUT_SHARD_HASH);
+  else if (g_strcmp0(opts.get.output_shard, "prefix") ==0)
+    return (UTIL_OUTPUT_SHARD_PREFIX);
+  return (UTIL_OUTPUT_SHARD_NONE);
+}
+
+static lutilPageCache _page_cache()
+{
+  if (g_strcmp0(opts.get.page_cache, "dontneed") ==0)
+    return (UTIL_PAGE_CACHE_DONTNEED);
+  else if (g_strcmp0(opts.get.page_cache, "direct") ==0)
+    return (UTIL_PAGE_CACHE_DIRECT);
+  return (UTIL_PAGE_CACHE_KEEP);
+}
+
 static void _copy_media_stream(lutil_query_properties_t qps, quvi_media_t qm,
                                const gchar *url)
 {
   struct lutil_build_fpath_s b;
   struct lget_s g;
+  subtitle_job_t sj;
+  gint r;
 
   memset(&b, 0, sizeof(struct lutil_build_fpath_s));
   memset(&g, 0, sizeof(struct lget_s));
@@ -231,31 +442,80 @@ static void _copy_media_stream(lutil_query_properties_t qps, quvi_media_t qm,
   b.output_regex = opts.get.output_regex;
   b.output_file = opts.get.output_file;
   b.output_name = opts.get.output_name;
+  b.output_shard = _output_shard();
   b.output_dir = opts.get.output_dir;
   b.xperr = qps->xperr;
   b.qm = qm;
 
   g.build_fpath = &b;
+  g.interrupted = sigterm_received;
   g.xperr = qps->xperr;
+  g.input_url = url;
   g.qm = qm;
-  g.q = q;
+  g.q = qps->q;
 
   g.opts.overwrite_if_exists = opts.get.overwrite;
   g.opts.skip_transfer = opts.get.skip_transfer;
+  g.opts.sidecar = opts.get.resume_sidecar;
+
+  g.opts.index_link = (g_strcmp0(opts.get.index_action, "link") ==0)
+                      ? TRUE
+                      : FALSE;
+
+  g.opts.checksum = (g_strcmp0(opts.get.checksum, "sha256") ==0)
+                    ? TRUE
+                    : FALSE;
+  g.opts.checksum_manifest = opts.get.checksum_manifest;
+  g.opts.write_buffer = (gsize) opts.get.write_buffer * 1024 * 1024;
+  g.opts.page_cache = _page_cache();
+  g.opts.throttle = opts.get.throttle;
+  g.opts.space.margin = (gdouble) opts.get.space_margin * 1048576;
+  g.opts.space.preallocate = opts.get.preallocate;
+  g.opts.space.check = opts.get.check_space;
   g.opts.resume_from = opts.get.resume_from;
+  g.opts.stats_file = opts.core.stats_file;
+  g.opts.stream_policy = qps->stream_policy;
   g.opts.stream = opts.core.stream;
 
+  g.opts.retry.max_delay = opts.get.retry_max_delay;
+  g.opts.retry.attempts = opts.get.retry;
+  g.opts.retry.delay = opts.get.retry_delay;
+
+  g.opts.stall.speed = opts.get.stall_speed;
+  g.opts.stall.time = opts.get.stall_time;
+
+  g.queue.pos = sched.pos;
+  g.queue.len = sched.len;
+
   g.opts.exec.external = (const gchar**) opts.exec.external;
   g.opts.exec.enable_stderr = opts.exec.enable_stderr;
   g.opts.exec.enable_stdout = opts.exec.enable_stdout;
   g.opts.exec.dump_argv = opts.exec.dump_argv;
 
+  sj = _subtitle_job_new(url);
+
+  sigterm_defer(TRUE);
   qps->exit_status = lget_new(&g);
 
+  r = _subtitle_job_finish(sj, (qps->exit_status == EXIT_SUCCESS)
+                           ? g.result.fpath
+                           : NULL,
+                           qps->xperr);
+
   if (qps->exit_status == EXIT_SUCCESS)
-    qps->exit_status = _copy_subtitle(g.result.fpath, url, qps->xperr);
+    qps->exit_status = r;
+
+  lutil_metrics_add(UTIL_METRIC_URLS_PROCESSED, url, 1);
 
+  if (qps->exit_status != EXIT_SUCCESS)
+    lutil_metrics_add(UTIL_METRIC_URLS_FAILED, url, 1);
+  else if (g.result.skipped == TRUE)
+    lutil_metrics_add(UTIL_METRIC_URLS_SKIPPED, url, 1);
+
+  _subtitle_job_free(sj);
   lget_free(&g);
+
+  sigterm_defer(FALSE);
 }
 
 static GSList *_media_streams(quvi_media_t qm)
@@ -312,6 +572,276 @@ static void _foreach_media_url(gpointer p, gpointer userdata,
     _print_streams(qps, qm);
 }
 
+static gint _priority_of(const gchar *url)
+{
+  if (sched.priority == NULL)
+    return (0);
+
+  return (GPOINTER_TO_INT(g_hash_table_lookup(sched.priority, url)));
+}
+
+/* Return the content length of the stream that would be chosen. */
+static gdouble _probe_content_length(lutil_query_properties_t qps,
+                                     quvi_media_t qm)
+{
+  quvi_http_metainfo_t qmi;
+  struct lget_s g;
+  gdouble n;
+
+  memset(&g, 0, sizeof(struct lget_s));
+
+  g.opts.stream_policy = qps->stream_policy;
+  g.opts.stream = opts.core.stream;
+  g.xperr = qps->xperr;
+  g.q = qps->q;
+
+  if (lget_choose_stream(&g, qm) != EXIT_SUCCESS)
+    return (0);
+
+  qmi = NULL;
+  n = 0;
+
+  if (lutil_query_metainfo(qps->q, qm, &qmi, qps->xperr) == EXIT_SUCCESS)
+    quvi_http_metainfo_get(qmi, QUVI_HTTP_METAINFO_PROPERTY_LENGTH_BYTES, &n);
+
+  quvi_http_metainfo_free(qmi);
+  return (n);
+}
+
+static void _queue_job(lutil_query_properties_t qps, quvi_media_t qm,
+                       const gchar *url, const gint priority)
+{
+  job_t j = g_new0(struct job_s, 1);
+
+  j->url = g_strdup(url);
+  j->priority = priority;
+  j->order = sched.len++;
+
+  if (sched.probe == TRUE && qm != NULL)
+    j->content_length = _probe_content_length(qps, qm);
+
+  sched.jobs = g_slist_prepend(sched.jobs, j);
+}
+
+static void _queue_media_url(gpointer p, gpointer userdata,
+                             const gchar *url)
+{
+  lutil_query_properties_t qps = (lutil_query_properties_t) p;
+
+  if (qps->exit_status != EXIT_SUCCESS)
+    return;
+
+  _queue_job(qps, (quvi_media_t) userdata, url, _priority_of(url));
+}
+
+/* The media URLs of a playlist inherit the priority of the playlist. */
+static void _queue_playlist_url(gpointer p, gpointer userdata,
+                                const gchar *url)
+{
+  lutil_query_properties_t qps;
+  quvi_playlist_t qp;
+  quvi_media_t qm;
+  gchar *m_url;
+  gint n;
+
+  qps = (lutil_query_properties_t) p;
+  qp = (quvi_playlist_t) userdata;
+
+  if (qps->exit_status != EXIT_SUCCESS)
+    return;
+
+  n = _priority_of(url);
+
+  while (quvi_playlist_media_next(qp) == QUVI_TRUE)
+    {
+      quvi_playlist_get(qp, QUVI_PLAYLIST_MEDIA_PROPERTY_URL, &m_url);
+
+      qm = NULL;
+      if (sched.probe == TRUE)
+        {
+          qm = quvi_media_new(qps->q, m_url);
+          if (quvi_ok(qps->q) == QUVI_FALSE)
+            {
+              quvi_media_free(qm);
+              qm = NULL;
+            }
+        }
+
+      _queue_job(qps, qm, m_url, n);
+      quvi_media_free(qm);
+    }
+}
+
+/*
+ * Smaller first with 'size' (unknown lengths last), then the higher
+ * priority first, then the input order.
+ */
+static gint _job_cmp(gconstpointer a, gconstpointer b)
+{
+  const struct job_s *x = a;
+  const struct job_s *y = b;
+
+  if (sched.by_size == TRUE && x->content_length != y->content_length)
+    {
+      if (x->content_length <=0)
+        return (1);
+      if (y->content_length <=0)
+        return (-1);
+      return ((x->content_length < y->content_length) ? -1:1);
+    }
+
+  if (x->priority != y->priority)
+    return ((x->priority > y->priority) ? -1:1);
+
+  return ((x->order < y->order) ? -1:1);
+}
+
+static void _job_free(job_t j)
+{
+  g_free(j->url);
+  g_free(j);
+}
+
+/*
+ * Check the free space for the queue as a whole, before the first
+ * transfer. Partially retrieved files are counted in full, and the
+ * unknown lengths are not counted at all.
+ */
+static gint _chk_queue_space()
+{
+  const gchar *d;
+  GSList *curr;
+  gdouble n;
+
+  if (opts.get.check_space == FALSE)
+    return (EXIT_SUCCESS);
+
+  curr = sched.jobs;
+  n = 0;
+
+  while (curr != NULL)
+    {
+      n += ((job_t) curr->data)->content_length;
+      curr = g_slist_next(curr);
+    }
+
+  d = (opts.get.output_dir != NULL) ? opts.get.output_dir : ".";
+
+  return (lutil_file_chk_space(d, n,
+                               (gdouble) opts.get.space_margin * 1048576,
+                               lprint_enum_errmsg));
+}
+
+static gint _run_queue(gpointer q, lutil_policy_t stream_policy)
+{
+  struct lutil_query_properties_s qps;
+  GSList *curr;
+
+  memset(&qps, 0, sizeof(struct lutil_query_properties_s));
+
+  qps.perr = lutil_print_stderr_unless_quiet;
+  qps.activity = _foreach_media_url;
+  qps.stream_policy = stream_policy;
+  qps.exit_status = EXIT_SUCCESS;
+  qps.xperr = lprint_enum_errmsg;
+  qps.q = q;
+
+  if (_chk_queue_space() != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  sched.jobs = g_slist_sort(sched.jobs, _job_cmp);
+  curr = sched.jobs;
+
+  for (sched.pos=1; curr != NULL && qps.exit_status == EXIT_SUCCESS;
+       ++sched.pos)
+    {
+      lutil_query_media(((job_t) curr->data)->url, &qps);
+      curr = g_slist_next(curr);
+    }
+  return (qps.exit_status);
+}
+
+static void _queue_free()
+{
+  lutil_slist_free_full(sched.jobs, (GFunc) _job_free);
+  memset(&sched, 0, sizeof(sched));
+}
+
+/* Playlist prefetch. */
+
+static gpointer _prefetch_resolve(gpointer q, const gchar *url,
+                                  gpointer userdata)
+{
+  quvi_media_t qm;
+  GTimer *t;
+
+  lutil_trace_begin("quvi", "query", url);
+  t = g_timer_new();
+  qm = quvi_media_new(q, url);
+  lutil_trace_end("quvi", "query");
+
+  lutil_metrics_add(UTIL_METRIC_RESOLVE_SECONDS, url,
+                    g_timer_elapsed(t, NULL));
+  g_timer_destroy(t);
+
+  return (qm);
+}
+
+static gint _prefetch_consume(gpointer q, gpointer qm, const gchar *url,
+                              const gchar *errmsg, gpointer userdata)
+{
+  struct lutil_query_properties_s p;
+  lutil_query_properties_t qps;
+
+  qps = (lutil_query_properties_t) userdata;
+
+  if (errmsg != NULL)
+    {
+      qps->xperr(_("libquvi: while parsing media properties: %s"), errmsg);
+      lutil_metrics_add(UTIL_METRIC_URLS_PROCESSED, url, 1);
+      lutil_metrics_add(UTIL_METRIC_URLS_FAILED, url, 1);
+      return (EXIT_FAILURE);
+    }
+
+  /* Use the handle that resolved the media. */
+
+  memcpy(&p, qps, sizeof(struct lutil_query_properties_s));
+  p.q = q;
+
+  _foreach_media_url(&p, qm, url);
+  return (p.exit_status);
+}
+
+/* Resolve up to N playlist items ahead of the current transfer. */
+static void _prefetch_playlist(lutil_query_properties_t qps,
+                               quvi_playlist_t qp, const guint n)
+{
+  struct lutil_resolve_ahead_s ra;
+  GSList *urls;
+  gchar *s;
+
+  urls = NULL;
+  while (quvi_playlist_media_next(qp) == QUVI_TRUE)
+    {
+      quvi_playlist_get(qp, QUVI_PLAYLIST_MEDIA_PROPERTY_URL, &s);
+      urls = g_slist_prepend(urls, g_strdup(s));
+    }
+  urls = g_slist_reverse(urls);
+
+  memset(&ra, 0, sizeof(struct lutil_resolve_ahead_s));
+
+  ra.resolve = _prefetch_resolve;
+  ra.free = (lutil_resolve_ahead_cb_free) quvi_media_free;
+  ra.quvi_init = setup_quvi_pool_handle;
+  ra.consume = _prefetch_consume;
+  ra.xperr = qps->xperr;
+  ra.userdata = qps;
+  ra.window = n;
+
+  qps->exit_status = lutil_resolve_ahead(&ra, urls);
+  lutil_slist_free_full(urls, (GFunc) g_free);
+}
+
 static void _foreach_playlist_url(gpointer p, gpointer userdata,
                                   const gchar *url)
 {
@@ -329,6 +859,12 @@ static void _foreach_playlist_url(gpointer p, gpointer userdata,
   if (qps->exit_status != EXIT_SUCCESS)
     return;
 
+  if (opts.get.playlist_prefetch >0)
+    {
+      _prefetch_playlist(qps, qp, opts.get.playlist_prefetch);
+      return;
+    }
+
   while (quvi_playlist_media_next(qp) == QUVI_TRUE)
     {
       quvi_playlist_get(qp, QUVI_PLAYLIST_MEDIA_PROPERTY_URL, &m_url);
@@ -362,27 +898,19 @@ static void _foreach_subtitle_url(gpointer p, gpointer userdata,
 
 static gint _cleanup(const gint r)
 {
+  sigterm_reset(&sao_int, &sao_term);
   sigwinch_reset(&sao);
   linput_free(&linput);
   quvi_free(q);
   return (r);
 }
 
-gint cmd_get(gint argc, gchar **argv)
+/* Save the media streams of the URLs in the parsed input. */
+gint cmd_get_run(gpointer q, gpointer p)
 {
   struct setup_query_s sq;
-
-  if (setup_opts(argc, argv, &lopts) != EXIT_SUCCESS)
-    return (EXIT_FAILURE);
-
-  if (lutil_parse_input(&linput, (const gchar**) opts.rargs) != EXIT_SUCCESS)
-    return (EXIT_FAILURE);
-
-  if (setup_quvi(&q) != EXIT_SUCCESS)
-    {
-      linput_free(&linput);
-      return (EXIT_FAILURE);
-    }
+  gboolean queued;
+  gint r;
 
   memset(&sq, 0, sizeof(struct setup_query_s));
 
@@ -395,12 +923,82 @@ gint cmd_get(gint argc, gchar **argv)
   sq.perr = lutil_print_stderr_unless_quiet;
   sq.xperr = lprint_enum_errmsg;
 
-  sq.linput = &linput;
+  sq.linput = (linput_t) p;
   sq.q = q;
 
+  queued = (g_strcmp0(opts.get.schedule, "size") ==0
+            || g_strcmp0(opts.get.schedule, "priority") ==0)
+           && opts.core.print_streams == FALSE
+           && opts.core.print_subtitles == FALSE;
+
+  if (queued == TRUE)
+    {
+      sched.by_size = (g_strcmp0(opts.get.schedule, "size") ==0)
+                      ? TRUE
+                      : FALSE;
+      sched.probe = (sched.by_size == TRUE
+                     || opts.get.check_space == TRUE)
+                    ? TRUE
+                    : FALSE;
+      sched.priority = sq.linput->url.priority;
+
+      sq.activity.playlist = _queue_playlist_url;
+      sq.activity.media = _queue_media_url;
+    }
+
+  if (opts.core.stream_policy != NULL)
+    {
+      sq.stream_policy = lutil_policy_new(opts.core.stream_policy,
+                                          setup_quvi_pool_handle,
+                                          sq.xperr);
+      if (sq.stream_policy == NULL)
+        return (EXIT_FAILURE);
+    }
+
+  if (opts.core.subtitle_language != NULL)
+    {
+      if (setup_quvi_pool_handle((gpointer*) &q_subtitle) != EXIT_SUCCESS)
+        {
+          lutil_policy_free(sq.stream_policy);
+          return (EXIT_FAILURE);
+        }
+    }
+
+  r = setup_query(&sq);
+
+  if (queued == TRUE)
+    {
+      if (r == EXIT_SUCCESS)
+        r = _run_queue(q, sq.stream_policy);
+      _queue_free();
+    }
+
+  lutil_policy_free(sq.stream_policy);
+
+  quvi_free(q_subtitle);
+  q_subtitle = NULL;
+
+  return (r);
+}
+
+gint cmd_get(gint argc, gchar **argv)
+{
+  if (setup_opts(argc, argv, &lopts) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  if (lutil_parse_input(&linput, (const gchar**) opts.rargs) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  if (setup_quvi(&q) != EXIT_SUCCESS)
+    {
+      linput_free(&linput);
+      return (EXIT_FAILURE);
+    }
+
   sigwinch_setup(&saw, &sao);
+  sigterm_setup(&sat, &sao_int, &sao_term);
 
-  return (_cleanup(setup_query(&sq)));
+  return (_cleanup(cmd_get_run(q, &linput)));
 }
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
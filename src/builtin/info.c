@@ -193,6 +193,7 @@ static gint _print_config_values(lopts_t lopts)
   lopts->entries = option_entries;
 
   lopts->cb.set_post_parse_defaults = cb_set_post_parse_defaults;
+  lopts->cb.set_pre_parse_defaults = cb_set_pre_parse_defaults;
   lopts->cb.parse_keyfile_values = cb_parse_keyfile_values;
   lopts->cb.get_config_fpath = cb_get_config_fpath;
 
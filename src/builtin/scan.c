@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <glib/gi18n.h>
 #include <quvi.h>
 
@@ -33,26 +34,49 @@
 #include "sig.h"
 #include "cmd.h"
 
-static gint exit_status = EXIT_SUCCESS;
-static lutil_cb_printerr xperr = NULL;
-static GSList *media_urls = NULL;
-static quvi_t q = NULL;
-
 static struct sigaction saw, sao;
 static struct linput_s linput;
 static struct lopts_s lopts;
 extern struct opts_s opts;
+static quvi_t q = NULL;
 
-static void _foreach_scan_url(gpointer p, gpointer userdata)
+/* Sizing of the crawl Bloom filters: items, false positive rate. */
+#define CRAWL_BLOOM_N 1000000
+#define CRAWL_BLOOM_P 0.0001
+
+/* The found media URLs handed over to --then at a time, when crawling. */
+#define CRAWL_THEN_BATCH 100
+
+struct scan_s
+{
+  lutil_cb_printerr xperr;
+  GHashTable *seen;
+  gint exit_status;
+  GSList *found;
+  guint n_found;
+  quvi_t q;
+  struct
+  {
+    lutil_bloom_t pages;
+    lutil_bloom_t media;
+    GHashTable *budget; /* host -> pages queued */
+    GHashTable *hosts; /* the hosts of the input URLs */
+    GSList *next; /* the pages for the next depth */
+    gboolean failed;
+    gint depth;
+  } crawl;
+};
+
+typedef struct scan_s *scan_t;
+
+static gint _print_scan(const scan_t s, quvi_t q, quvi_scan_t qs)
 {
   lprint_cb_scan_print_buffer scan_print_buffer;
   lprint_cb_scan_properties   scan_properties;
   lprint_cb_scan_free         scan_free;
   lprint_cb_scan_new          scan_new;
-  quvi_scan_t qs;
-
-  if (exit_status != EXIT_SUCCESS)
-    return;
+  gpointer h;
+  gint r;
 
   /* default. */
 
@@ -89,38 +113,379 @@ static void _foreach_scan_url(gpointer p, gpointer userdata)
     }
 #endif
 
-  qs = quvi_scan_new(q, (const gchar*) p);
-  if (quvi_ok(q) == QUVI_FALSE)
+  r = scan_new(q, &h);
+  if (r == EXIT_SUCCESS)
+    {
+      r = scan_properties(qs, h);
+      if (r == EXIT_SUCCESS)
+        r = scan_print_buffer(h);
+    }
+  scan_free(h);
+
+  return (r);
+}
+
+/* Collect the found media URLs for --then, skip the duplicates. */
+static void _collect_scan(const scan_t s, quvi_scan_t qs)
+{
+  const gchar *u;
+
+  while ( (u = quvi_scan_next_media_url(qs)) != NULL)
+    {
+      if (g_hash_table_lookup(s->seen, u) != NULL)
+        continue;
+
+      s->found = g_slist_prepend(s->found, g_strdup(u));
+      g_hash_table_insert(s->seen, s->found->data, s->found->data);
+    }
+}
+
+static gint _scan_done(gpointer q, gpointer qs, const gchar *url,
+                       const gchar *errmsg, gpointer userdata)
+{
+  scan_t s = (scan_t) userdata;
+
+  if (errmsg != NULL)
+    {
+      s->xperr(_("libquvi: while scanning: %s"), errmsg);
+      return (EXIT_FAILURE);
+    }
+
+  if (opts.scan.then != NULL)
+    {
+      _collect_scan(s, qs);
+      return (EXIT_SUCCESS);
+    }
+  return (_print_scan(s, q, qs));
+}
+
+static void _foreach_scan_url(gpointer p, gpointer userdata)
+{
+  quvi_scan_t qs;
+  scan_t s;
+
+  g_assert(userdata != NULL);
+  s = (scan_t) userdata;
+
+  if (s->exit_status != EXIT_SUCCESS)
+    return;
+
+  qs = quvi_scan_new(s->q, (const gchar*) p);
+
+  s->exit_status =
+    _scan_done(s->q, qs, p,
+               (quvi_ok(s->q) == QUVI_FALSE) ? quvi_errmsg(s->q) : NULL,
+               s);
+
+  quvi_scan_free(qs);
+}
+
+static gpointer _scan_resolve(gpointer q, const gchar *url,
+                              gpointer userdata)
+{
+  return (quvi_scan_new(q, url));
+}
+
+/* Scan the input URLs concurrently, handle the results in order. */
+static gint _scan_concurrently(const scan_t s, const GSList *urls,
+                               const guint n)
+{
+  struct lutil_resolve_ahead_s ra;
+
+  memset(&ra, 0, sizeof(struct lutil_resolve_ahead_s));
+
+  ra.resolve = _scan_resolve;
+  ra.free = (lutil_resolve_ahead_cb_free) quvi_scan_free;
+  ra.quvi_init = setup_quvi_pool_handle;
+  ra.consume = _scan_done;
+  ra.xperr = s->xperr;
+  ra.userdata = s;
+  ra.window = n-1;
+
+  return (lutil_resolve_ahead(&ra, urls));
+}
+
+/* Crawl. */
+
+struct crawl_page_s
+{
+  quvi_scan_t qs;
+  GSList *links;
+};
+
+typedef struct crawl_page_s *crawl_page_t;
+
+static void _crawl_page_free(gpointer p)
+{
+  crawl_page_t c = (crawl_page_t) p;
+
+  if (c == NULL)
+    return;
+
+  lutil_slist_free_full(c->links, (GFunc) g_free);
+  quvi_scan_free(c->qs);
+  g_free(c);
+}
+
+/*
+ * Called in a worker thread. Fetch the links of the page unless it is
+ * at the depth limit, then scan it. The pages that are not HTML (e.g.
+ * media files linked to) are not scanned: libquvi would fetch them.
+ */
+static gpointer _crawl_resolve(gpointer q, const gchar *url,
+                               gpointer userdata)
+{
+  crawl_page_t c;
+  gboolean html;
+  scan_t s;
+
+  s = (scan_t) userdata;
+  c = g_new0(struct crawl_page_s, 1);
+
+  html = lutil_page_links(q, url,
+                          (s->crawl.depth < opts.scan.crawl_depth)
+                          ? &c->links
+                          : NULL);
+
+  if (html == TRUE || s->crawl.depth ==0)
+    c->qs = quvi_scan_new(q, url);
+
+  return (c);
+}
+
+/* Queue the page for the next depth, unless seen or over the budget. */
+static void _crawl_enqueue(const scan_t s, const gchar *url)
+{
+  gchar *host;
+  guint n;
+
+  host = lutil_url_host(url);
+  if (host == NULL)
+    return;
+
+  if (g_hash_table_lookup(s->crawl.hosts, host) == NULL)
     {
-      xperr(_("libquvi: while scanning: %s"), quvi_errmsg(q));
-      exit_status = EXIT_FAILURE;
+      g_free(host);
+      return;
     }
+
+  n = GPOINTER_TO_UINT(g_hash_table_lookup(s->crawl.budget, host));
+
+  if (opts.scan.crawl_host_budget >0
+      && n >= (guint) opts.scan.crawl_host_budget)
+    {
+      g_free(host);
+      return;
+    }
+
+  if (lutil_bloom_test_and_add(s->crawl.pages, url) == TRUE)
+    {
+      g_free(host);
+      return;
+    }
+
+  /* The table takes the ownership of the key. */
+  g_hash_table_replace(s->crawl.budget, host, GUINT_TO_POINTER(n+1));
+  s->crawl.next = g_slist_prepend(s->crawl.next, g_strdup(url));
+}
+
+/* Hand the found media URLs over to the --then command. */
+static gint _then(const scan_t s)
+{
+  struct linput_s l;
+  gint r;
+
+  memset(&l, 0, sizeof(struct linput_s));
+  l.url.input = g_slist_reverse(s->found);
+  s->found = NULL;
+  s->n_found = 0;
+
+  if (g_strcmp0(opts.scan.then, "get") ==0)
+    r = cmd_get_run(s->q, &l);
   else
+    r = cmd_dump_run(s->q, &l);
+
+  linput_free(&l);
+  return (r);
+}
+
+/* Called in the crawl order. Print the media URLs not seen before. */
+static gint _crawl_done(gpointer q, gpointer p, const gchar *url,
+                        const gchar *errmsg, gpointer userdata)
+{
+  const gchar *u;
+  crawl_page_t c;
+  GSList *curr;
+  scan_t s;
+
+  s = (scan_t) userdata;
+  c = (crawl_page_t) p;
+
+  if (c->qs == NULL) /* Not an HTML page. */
+    return (EXIT_SUCCESS);
+
+  /* Log the failures but keep crawling the rest of the pages. */
+
+  if (errmsg != NULL)
     {
-      gpointer h;
+      s->xperr(_("libquvi: while scanning %s: %s"), url, errmsg);
+      s->crawl.failed = TRUE;
+      return (EXIT_SUCCESS);
+    }
 
-      exit_status = scan_new(q, &h);
-      if (exit_status == EXIT_SUCCESS)
+  while ( (u = quvi_scan_next_media_url(c->qs)) != NULL)
+    {
+      if (lutil_bloom_test_and_add(s->crawl.media, u) == TRUE)
+        continue;
+
+      if (opts.scan.then != NULL)
         {
-          exit_status = scan_properties(qs, h);
-          if (exit_status == EXIT_SUCCESS)
-            exit_status = scan_print_buffer(h);
+          s->found = g_slist_prepend(s->found, g_strdup(u));
+          ++s->n_found;
         }
-      scan_free(h);
+      else if (g_strcmp0(opts.core.print_format, "enum") ==0)
+        lprint_enum_scan_media_url(u);
+      else
+        lprint_rfc2483_scan_media_url(u);
     }
-  quvi_scan_free(qs);
+
+  if (opts.scan.then == NULL)
+    fflush(stdout);
+  else if (s->n_found >= CRAWL_THEN_BATCH)
+    {
+      /* Keep the list bounded, the crawl may go on for long. */
+      if (_then(s) != EXIT_SUCCESS)
+        return (EXIT_FAILURE);
+    }
+
+  for (curr=c->links; curr != NULL; curr=g_slist_next(curr))
+    _crawl_enqueue(s, (const gchar*) curr->data);
+
+  return (EXIT_SUCCESS);
 }
 
-static gint _cleanup()
+/*
+ * Crawl breadth-first from the input URLs, following the links to the
+ * hosts of the input URLs up to --crawl-depth. The visited pages and
+ * the found media URLs are de-duplicated using Bloom filters, which
+ * keeps the memory use bounded regardless of the size of the crawl.
+ */
+static gint _crawl(const scan_t s, const GSList *urls)
 {
-  lutil_slist_free_full(media_urls, (GFunc) g_free);
-  media_urls = NULL;
+  struct lutil_resolve_ahead_s ra;
+  GSList *curr;
+  gint r;
+
+  if (opts.scan.then == NULL
+      && g_strcmp0(opts.core.print_format, "enum") !=0
+      && g_strcmp0(opts.core.print_format, "rfc2483") !=0)
+    {
+      s->xperr(_("--crawl-depth supports --print-format enum and "
+                 "rfc2483 only"));
+      return (EXIT_FAILURE);
+    }
+
+  s->crawl.pages = lutil_bloom_new(CRAWL_BLOOM_N, CRAWL_BLOOM_P);
+  s->crawl.media = lutil_bloom_new(CRAWL_BLOOM_N, CRAWL_BLOOM_P);
+
+  s->crawl.budget =
+    g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  s->crawl.hosts =
+    g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  for (; urls != NULL; urls=g_slist_next(urls))
+    {
+      gchar *host = lutil_url_host((const gchar*) urls->data);
+      if (host != NULL)
+        g_hash_table_replace(s->crawl.hosts, host, GINT_TO_POINTER(1));
+      _crawl_enqueue(s, (const gchar*) urls->data);
+    }
+
+  memset(&ra, 0, sizeof(struct lutil_resolve_ahead_s));
+
+  ra.resolve = _crawl_resolve;
+  ra.free = _crawl_page_free;
+  ra.quvi_init = setup_quvi_pool_handle;
+  ra.consume = _crawl_done;
+  ra.xperr = s->xperr;
+  ra.userdata = s;
+  ra.window = opts.scan.jobs-1;
+
+  r = EXIT_SUCCESS;
+
+  for (s->crawl.depth=0;
+       s->crawl.next != NULL && r == EXIT_SUCCESS;
+       ++s->crawl.depth)
+    {
+      curr = g_slist_reverse(s->crawl.next);
+      s->crawl.next = NULL;
+
+      r = lutil_resolve_ahead(&ra, curr);
+      lutil_slist_free_full(curr, (GFunc) g_free);
+    }
+
+  lutil_slist_free_full(s->crawl.next, (GFunc) g_free);
+  g_hash_table_destroy(s->crawl.budget);
+  g_hash_table_destroy(s->crawl.hosts);
+  lutil_bloom_free(s->crawl.pages);
+  lutil_bloom_free(s->crawl.media);
 
+  return (r);
+}
+
+static gint _cleanup(const gint r)
+{
   sigwinch_reset(&sao);
   linput_free(&linput);
   quvi_free(q);
+  return (r);
+}
+
+/* Scan the URLs in the parsed input for embedded media URLs. */
+gint cmd_scan_run(gpointer q, gpointer p)
+{
+  struct scan_s s;
+  linput_t l;
+  guint n;
+
+  memset(&s, 0, sizeof(struct scan_s));
+  l = (linput_t) p;
+
+  s.seen = g_hash_table_new(g_str_hash, g_str_equal);
+  s.xperr = lprint_enum_errmsg; /* rfc2483 uses this also. */
+  s.exit_status = EXIT_SUCCESS;
+  s.q = q;
 
-  return (exit_status);
+#ifdef HAVE_JSON_GLIB
+  if (g_strcmp0(opts.core.print_format, "json") ==0)
+    s.xperr = lprint_json_errmsg;
+#endif
+#ifdef HAVE_LIBXML
+  if (g_strcmp0(opts.core.print_format, "xml") ==0)
+    s.xperr = lprint_xml_errmsg;
+#endif
+
+  n = MIN(g_slist_length(l->url.input), (guint) opts.scan.jobs);
+
+  if (opts.scan.crawl_depth >0)
+    s.exit_status = _crawl(&s, l->url.input);
+  else if (n >1)
+    s.exit_status = _scan_concurrently(&s, l->url.input, n);
+  else
+    g_slist_foreach(l->url.input, _foreach_scan_url, &s);
+
+  if (s.exit_status == EXIT_SUCCESS && opts.scan.then != NULL)
+    s.exit_status = _then(&s);
+
+  /* Report the pages that failed to scan during the crawl. */
+  if (s.exit_status == EXIT_SUCCESS && s.crawl.failed == TRUE)
+    s.exit_status = EXIT_FAILURE;
+
+  lutil_slist_free_full(s.found, (GFunc) g_free);
+  g_hash_table_destroy(s.seen);
+
+  return (s.exit_status);
 }
 
 gint cmd_scan(gint argc, gchar **argv)
@@ -139,19 +504,7 @@ gint cmd_scan(gint argc, gchar **argv)
 
   sigwinch_setup(&saw, &sao);
 
-  xperr = lprint_enum_errmsg; /* rfc2483 uses this also. */
-
-#ifdef HAVE_JSON_GLIB
-  if (g_strcmp0(opts.core.print_format, "json") ==0)
-    xperr = lprint_json_errmsg;
-#endif
-#ifdef HAVE_LIBXML
-  if (g_strcmp0(opts.core.print_format, "xml") ==0)
-    xperr = lprint_xml_errmsg;
-#endif
-
-  g_slist_foreach(linput.url.input, _foreach_scan_url, NULL);
-  return (_cleanup());
+  return (_cleanup(cmd_scan_run(q, &linput)));
 }
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -0,0 +1,597 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * "serve" keeps the parsed configuration and a pool of initialized
+ * libquvi handles resident, and runs the dump, get and scan commands
+ * for the clients connecting to a UNIX socket or a local HTTP port.
+ *
+ * Each request is a JSON object, e.g.:
+ *  {"command": "dump", "url": ["http://..."]}
+ *
+ * The response is a JSON object with the exit status of the command and
+ * anything the command printed to the stdout and the stderr, e.g.:
+ *  {"command": "dump", "exit_status": 0, "output": "...", "error": ""}
+ *
+ * The UNIX socket expects and sends one JSON object per line. The HTTP
+ * port accepts the JSON object as the body of a POST request.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include <json-glib/json-glib.h>
+#include <quvi.h>
+
+#include "linput.h"
+#include "lopts.h"
+#include "lutil.h"
+#include "setup.h"
+#include "opts.h"
+#include "cmd.h"
+
+static lutil_quvi_pool_t pool = NULL;
+static struct lopts_s lopts;
+extern struct opts_s opts;
+
+/* Serializes the "get" requests: libget is not reentrant. */
+static GMutex get_lock;
+
+/* Output capture. */
+
+struct capture_s
+{
+  GString *out;
+  GString *err;
+};
+
+typedef struct capture_s *capture_t;
+
+static GPrivate capture = G_PRIVATE_INIT(NULL);
+
+static void _print_cb(const gchar *s)
+{
+  capture_t c = (capture_t) g_private_get(&capture);
+  if (c != NULL)
+    g_string_append(c->out, s);
+  else
+    {
+      fputs(s, stdout);
+      fflush(stdout);
+    }
+}
+
+static void _printerr_cb(const gchar *s)
+{
+  capture_t c = (capture_t) g_private_get(&capture);
+  if (c != NULL)
+    g_string_append(c->err, s);
+  else
+    fputs(s, stderr);
+}
+
+/* Requests. */
+
+typedef gint (*serve_cb_run)(gpointer, gpointer);
+
+struct serve_cmd_s
+{
+  const gchar *cmd;
+  const serve_cb_run cb;
+  const gboolean serialize;
+};
+
+static const struct serve_cmd_s serve_cmds[] =
+{
+  {"dump", cmd_dump_run, FALSE},
+  {"get",  cmd_get_run,  TRUE},
+  {"scan", cmd_scan_run, FALSE},
+  {NULL, NULL, FALSE}
+};
+
+typedef struct serve_cmd_s *serve_cmd_t;
+
+static gchar *_response_new(const gchar *cmd, const gint r,
+                            const gchar *out, const gchar *err)
+{
+  JsonGenerator *g;
+  JsonBuilder *b;
+  JsonNode *n;
+  gchar *s;
+
+  b = json_builder_new();
+  json_builder_begin_object(b);
+
+  if (cmd != NULL)
+    {
+      json_builder_set_member_name(b, "command");
+      json_builder_add_string_value(b, cmd);
+    }
+
+  json_builder_set_member_name(b, "exit_status");
+  json_builder_add_int_value(b, r);
+
+  json_builder_set_member_name(b, "output");
+  json_builder_add_string_value(b, (out != NULL) ? out:"");
+
+  json_builder_set_member_name(b, "error");
+  json_builder_add_string_value(b, (err != NULL) ? err:"");
+
+  json_builder_end_object(b);
+
+  g = json_generator_new();
+  n = json_builder_get_root(b);
+
+  json_generator_set_root(g, n);
+  s = json_generator_to_data(g, NULL);
+
+  json_node_free(n);
+  g_object_unref(g);
+  g_object_unref(b);
+
+  return (s);
+}
+
+static gchar *_response_error(const gchar *cmd, gchar *e)
+{
+  gchar *s = _response_new(cmd, EXIT_FAILURE, NULL, e);
+  g_free(e);
+  return (s);
+}
+
+static void _input_add(linput_t l, const gchar *url)
+{
+  if (url != NULL && strlen(url) >0)
+    l->url.input = lutil_slist_prepend_if_unique(l->url.input, url);
+}
+
+/* Fill the input from the "url" member: a string or an array of them. */
+static gint _input_from(linput_t l, JsonObject *o)
+{
+  JsonNode *n;
+
+  if (json_object_has_member(o, "url") == FALSE)
+    return (EXIT_FAILURE);
+
+  n = json_object_get_member(o, "url");
+
+  if (JSON_NODE_HOLDS_ARRAY(n))
+    {
+      JsonArray *a;
+      guint i, len;
+
+      a = json_node_get_array(n);
+      len = json_array_get_length(a);
+
+      for (i=0; i<len; ++i)
+        _input_add(l, json_array_get_string_element(a, i));
+    }
+  else if (JSON_NODE_HOLDS_VALUE(n))
+    _input_add(l, json_node_get_string(n));
+
+  l->url.input = g_slist_reverse(l->url.input);
+
+  return ((l->url.input != NULL) ? EXIT_SUCCESS:EXIT_FAILURE);
+}
+
+/* "scan --then get" runs get for the found media URLs. */
+static gboolean _serialize(const serve_cmd_t c)
+{
+  if (c->cb == cmd_scan_run && g_strcmp0(opts.scan.then, "get") ==0)
+    return (TRUE);
+  return (c->serialize);
+}
+
+static gint _run(const serve_cmd_t c, linput_t l, capture_t cap)
+{
+  gboolean serialize;
+  quvi_t q;
+  gint r;
+
+  q = lutil_quvi_pool_pop(pool);
+  g_private_set(&capture, cap);
+
+  serialize = _serialize(c);
+  if (serialize == TRUE)
+    g_mutex_lock(&get_lock);
+
+  r = c->cb(q, l);
+
+  if (serialize == TRUE)
+    g_mutex_unlock(&get_lock);
+
+  g_private_set(&capture, NULL);
+  lutil_quvi_pool_push(pool, q);
+
+  return (r);
+}
+
+static gchar *_handle_request(const gchar *data, const gssize len)
+{
+  struct linput_s linput;
+  struct capture_s cap;
+  const gchar *cmd;
+  JsonParser *jp;
+  serve_cmd_t c;
+  JsonObject *o;
+  JsonNode *n;
+  GError *e;
+  gchar *s;
+  gint r;
+
+  jp = json_parser_new();
+  e = NULL;
+
+  if (json_parser_load_from_data(jp, data, len, &e) == FALSE)
+    {
+      s = g_strdup_printf(_("error: while parsing request: %s\n"),
+                          e->message);
+      g_object_unref(jp);
+      g_error_free(e);
+
+      return (_response_error(NULL, s));
+    }
+
+  n = json_parser_get_root(jp);
+  if (n == NULL || JSON_NODE_HOLDS_OBJECT(n) == FALSE)
+    {
+      g_object_unref(jp);
+      return (_response_error(NULL,
+                              g_strdup(_("error: request is not a JSON "
+                                         "object\n"))));
+    }
+
+  o = json_node_get_object(n);
+  cmd = NULL;
+
+  if (json_object_has_member(o, "command") == TRUE)
+    cmd = json_object_get_string_member(o, "command");
+
+  c = (serve_cmd_t) serve_cmds;
+  while (c->cmd != NULL && g_strcmp0(c->cmd, cmd) !=0)
+    ++c;
+
+  if (c->cmd == NULL)
+    {
+      s = g_strdup_printf(_("error: `%s' is not a supported command\n"),
+                          (cmd != NULL) ? cmd:"");
+      g_object_unref(jp);
+      return (_response_error(NULL, s));
+    }
+
+  memset(&linput, 0, sizeof(struct linput_s));
+
+  if (_input_from(&linput, o) != EXIT_SUCCESS)
+    {
+      g_object_unref(jp);
+      linput_free(&linput);
+      return (_response_error(c->cmd, g_strdup(_("error: no input URL\n"))));
+    }
+  g_object_unref(jp);
+
+  cap.out = g_string_new(NULL);
+  cap.err = g_string_new(NULL);
+
+  r = _run(c, &linput, &cap);
+  s = _response_new(c->cmd, r, cap.out->str, cap.err->str);
+
+  g_string_free(cap.out, TRUE);
+  g_string_free(cap.err, TRUE);
+  linput_free(&linput);
+
+  return (s);
+}
+
+/* UNIX socket: one JSON object per line. */
+
+static gboolean _write(GOutputStream *o, const gchar *s, const gsize n)
+{
+  return (g_output_stream_write_all(o, s, n, NULL, NULL, NULL));
+}
+
+static gboolean _unix_run_cb(GThreadedSocketService *service,
+                             GSocketConnection *conn,
+                             GObject *source, gpointer data)
+{
+  GDataInputStream *i;
+  GOutputStream *o;
+  gboolean ok;
+  gchar *l;
+  gsize n;
+
+  i = g_data_input_stream_new(
+        g_io_stream_get_input_stream(G_IO_STREAM(conn)));
+  o = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+  ok = TRUE;
+
+  while (ok == TRUE
+         && (l = g_data_input_stream_read_line(i, &n, NULL, NULL)) != NULL)
+    {
+      g_strstrip(l);
+      if (strlen(l) >0)
+        {
+          gchar *s = _handle_request(l, -1);
+          ok = _write(o, s, strlen(s)) && _write(o, "\n", 1);
+          g_free(s);
+        }
+      g_free(l);
+    }
+  g_object_unref(i);
+  return (TRUE);
+}
+
+/* HTTP: the JSON object is the body of a POST request. */
+
+static const gsize http_max_body = 1<<20;
+
+static void _http_reply(GOutputStream *o, const gchar *status,
+                        const gchar *body)
+{
+  gchar *s;
+  gsize n;
+
+  n = strlen(body);
+  s = g_strdup_printf("HTTP/1.0 %s\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: %"G_GSIZE_FORMAT"\r\n"
+                      "Connection: close\r\n\r\n", status, n+1);
+
+  if (_write(o, s, strlen(s)) == TRUE && _write(o, body, n) == TRUE)
+    _write(o, "\n", 1);
+
+  g_free(s);
+}
+
+static void _http_error(GOutputStream *o, const gchar *status)
+{
+  gchar *s = _response_error(NULL, g_strdup_printf("error: %s\n", status));
+  _http_reply(o, status, s);
+  g_free(s);
+}
+
+static gboolean _http_run_cb(GThreadedSocketService *service,
+                             GSocketConnection *conn,
+                             GObject *source, gpointer data)
+{
+  gsize n, content_length;
+  GDataInputStream *i;
+  GOutputStream *o;
+  gboolean post;
+  gchar *l;
+
+  i = g_data_input_stream_new(
+        g_io_stream_get_input_stream(G_IO_STREAM(conn)));
+  o = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+
+  l = g_data_input_stream_read_line(i, &n, NULL, NULL);
+  if (l == NULL)
+    {
+      g_object_unref(i);
+      return (TRUE);
+    }
+
+  post = g_str_has_prefix(l, "POST ");
+  content_length = 0;
+  g_free(l);
+
+  /* Headers. */
+
+  while ( (l = g_data_input_stream_read_line(i, &n, NULL, NULL)) != NULL)
+    {
+      g_strstrip(l);
+      if (strlen(l) ==0)
+        {
+          g_free(l);
+          break;
+        }
+      if (g_ascii_strncasecmp(l, "content-length:", 15) ==0)
+        content_length = g_ascii_strtoull(l+15, NULL, 10);
+      g_free(l);
+    }
+
+  if (post == FALSE)
+    _http_error(o, "405 Method Not Allowed");
+  else if (content_length ==0)
+    _http_error(o, "411 Length Required");
+  else if (content_length > http_max_body)
+    _http_error(o, "413 Request Entity Too Large");
+  else
+    {
+      gchar *b = g_malloc0(content_length+1);
+
+      if (g_input_stream_read_all(G_INPUT_STREAM(i), b, content_length,
+                                  &n, NULL, NULL) == TRUE
+          && n == content_length)
+        {
+          gchar *s = _handle_request(b, n);
+          _http_reply(o, "200 OK", s);
+          g_free(s);
+        }
+      else
+        _http_error(o, "400 Bad Request");
+
+      g_free(b);
+    }
+  g_object_unref(i);
+  return (TRUE);
+}
+
+/* Setup. */
+
+static GSocketService *_service_new(GSocketAddress *a, GCallback cb)
+{
+  GSocketService *s;
+  GError *e;
+
+  s = g_threaded_socket_service_new(opts.serve.handles);
+  e = NULL;
+
+  if (g_socket_listener_add_address(G_SOCKET_LISTENER(s), a,
+                                    G_SOCKET_TYPE_STREAM,
+                                    G_SOCKET_PROTOCOL_DEFAULT,
+                                    NULL, NULL, &e) == FALSE)
+    {
+      g_printerr(_("error: while binding the socket: %s\n"), e->message);
+      g_error_free(e);
+      g_object_unref(s);
+      return (NULL);
+    }
+  g_signal_connect(s, "run", cb, NULL);
+  g_socket_service_start(s);
+
+  return (s);
+}
+
+static GSocketService *_unix_service_new()
+{
+  GSocketService *s;
+  GSocketAddress *a;
+  struct stat st;
+
+  /* Remove the stale socket left behind by an earlier instance. */
+
+  if (g_lstat(opts.serve.socket, &st) ==0 && S_ISSOCK(st.st_mode))
+    g_unlink(opts.serve.socket);
+
+  a = g_unix_socket_address_new(opts.serve.socket);
+  s = _service_new(a, G_CALLBACK(_unix_run_cb));
+  g_object_unref(a);
+
+  if (s != NULL)
+    {
+      g_chmod(opts.serve.socket, 0600);
+      g_printerr(_("serve: listening on %s\n"), opts.serve.socket);
+    }
+  return (s);
+}
+
+static GSocketService *_http_service_new()
+{
+  GSocketService *s;
+  GSocketAddress *a;
+
+  /* Bind to the loopback interface only. */
+
+  a = g_inet_socket_address_new_from_string("127.0.0.1", opts.serve.port);
+  s = _service_new(a, G_CALLBACK(_http_run_cb));
+  g_object_unref(a);
+
+  if (s != NULL)
+    {
+      g_printerr(_("serve: listening on http://127.0.0.1:%d/\n"),
+                 opts.serve.port);
+    }
+  return (s);
+}
+
+static void _service_free(GSocketService *s)
+{
+  if (s == NULL)
+    return;
+
+  g_socket_service_stop(s);
+  g_socket_listener_close(G_SOCKET_LISTENER(s));
+  g_object_unref(s);
+}
+
+static gboolean _quit_cb(gpointer data)
+{
+  g_main_loop_quit((GMainLoop*) data);
+  return (FALSE);
+}
+
+gint cmd_serve(gint argc, gchar **argv)
+{
+  GSocketService *us, *hs;
+  GMainLoop *loop;
+  gint r;
+
+  if (setup_opts(argc, argv, &lopts) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  if (opts.serve.socket == NULL && opts.serve.port ==0)
+    {
+      opts.serve.socket =
+        g_build_filename(g_get_user_runtime_dir(), "quvi.sock", NULL);
+    }
+
+  pool = lutil_quvi_pool_new(opts.serve.handles,
+                             setup_quvi_pool_handle);
+  if (pool == NULL)
+    return (EXIT_FAILURE);
+
+  signal(SIGPIPE, SIG_IGN);
+
+  g_set_printerr_handler(_printerr_cb);
+  g_set_print_handler(_print_cb);
+
+  us = hs = NULL;
+  r = EXIT_SUCCESS;
+
+  if (opts.serve.socket != NULL)
+    {
+      us = _unix_service_new();
+      if (us == NULL)
+        r = EXIT_FAILURE;
+    }
+
+  if (opts.serve.port >0 && r == EXIT_SUCCESS)
+    {
+      hs = _http_service_new();
+      if (hs == NULL)
+        r = EXIT_FAILURE;
+    }
+
+  if (r == EXIT_SUCCESS)
+    {
+      loop = g_main_loop_new(NULL, FALSE);
+
+      g_unix_signal_add(SIGTERM, _quit_cb, loop);
+      g_unix_signal_add(SIGINT, _quit_cb, loop);
+
+      g_main_loop_run(loop);
+      g_main_loop_unref(loop);
+    }
+
+  _service_free(us);
+  _service_free(hs);
+
+  if (us != NULL)
+    g_unlink(opts.serve.socket);
+
+  /* Waits for the requests in progress to release their handles. */
+  lutil_quvi_pool_free(pool);
+  pool = NULL;
+
+  g_set_printerr_handler(NULL);
+  g_set_print_handler(NULL);
+
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
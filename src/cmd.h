@@ -25,6 +25,15 @@ gint cmd_dump(gint, gchar**);
 gint cmd_get(gint, gchar**);
 gint cmd_info(gint, gchar**);
 gint cmd_scan(gint, gchar**);
+#ifdef HAVE_SERVE
+gint cmd_serve(gint, gchar**);
+#endif
+
+/* Run the command over a parsed input (linput_t) with a quvi_t. */
+
+gint cmd_dump_run(gpointer, gpointer);
+gint cmd_get_run(gpointer, gpointer);
+gint cmd_scan_run(gpointer, gpointer);
 
 #endif /* cmd_h */
 
@@ -31,8 +31,24 @@
 
 static gboolean force_skip_transfer = FALSE;
 static gboolean transfer_skipped = FALSE;
+static gboolean restart_retry = FALSE;
+static gboolean resume_retry = FALSE;
+static quvi_media_t qm_failover = NULL;
+static struct curl_slist *if_range = NULL;
+static struct lutil_sidecar_s sidecar;
+static gboolean sidecar_valid = FALSE;
+static gboolean range_checked = FALSE;
+static gchar *resp_last_modified = NULL;
+static gchar *resp_etag = NULL;
+static struct lutil_sha256_s sha;
+static gboolean sha_complete = FALSE;
+static gdouble written = 0;
+static guint32 adler = 1;
 static quvi_http_metainfo_t qmi = NULL;
 static struct lutil_file_open_s fo;
+static struct lutil_iow_stats_s iow_stats;
+static lutil_iow_t iow = NULL;
+static gboolean paused = FALSE;
 static gdouble content_length = 0;
 static gchar *content_type = NULL;
 static gchar *io_errmsg = NULL;
@@ -88,17 +104,46 @@ static void _content_props_from(const HttpResponseType hrt)
   pbar->content_bytes = content_length;
 }
 
+/* Wait for the pending writes to the file. */
+static gint _close_writer()
+{
+  gint r;
+
+  if (iow == NULL)
+    return (EXIT_SUCCESS);
+
+  lutil_iow_stats(iow, &iow_stats);
+
+  r = lutil_iow_free(iow);
+  iow = NULL;
+
+  return (r);
+}
+
 static gint _cleanup(const gint r)
 {
   quvi_http_metainfo_free(qmi);
   qmi = NULL;
 
+  lutil_sidecar_clear(&sidecar);
+
+  g_free(resp_last_modified);
+  resp_last_modified = NULL;
+
+  g_free(resp_etag);
+  resp_etag = NULL;
+
+  curl_slist_free_all(if_range);
+  if_range = NULL;
+
   g_free(content_type);
   content_type = NULL;
 
   lpbar_free(pbar);
   pbar = NULL;
 
+  _close_writer();
+
   if (fo.result.file != NULL)
     {
       fflush(fo.result.file);
@@ -107,6 +152,12 @@ static gint _cleanup(const gint r)
     }
   c = NULL;
 
+  if (qm_failover != NULL)
+    {
+      g->build_fpath->qm = g->qm;
+      quvi_media_free(qm_failover);
+      qm_failover = NULL;
+    }
   return (r);
 }
 
@@ -179,8 +230,11 @@ static gint _build_fpath()
   lutil_build_fpath_t b;
   quvi_file_ext_t qfe;
 
-  if (g->result.fpath != NULL) /* Skip re-building. */
-    return (EXIT_SUCCESS);
+  if (g->result.fpath != NULL) /* Skip re-building, see _retry. */
+    {
+      pbar->fname = g_path_get_basename(g->result.fpath);
+      return (EXIT_SUCCESS);
+    }
 
   b = g->build_fpath;
   qfe = quvi_file_ext_new(g->q, content_type);
@@ -206,6 +260,185 @@ static gint _build_fpath()
   return (EXIT_FAILURE);
 }
 
+/* Return TRUE if the response validators match those of the sidecar. */
+static gboolean _validators_match()
+{
+  if (sidecar.etag != NULL && resp_etag != NULL)
+    return ((g_strcmp0(sidecar.etag, resp_etag) ==0) ? TRUE:FALSE);
+
+  if (sidecar.last_modified != NULL && resp_last_modified != NULL)
+    {
+      return ((g_strcmp0(sidecar.last_modified,
+                         resp_last_modified) ==0) ? TRUE:FALSE);
+    }
+  return (TRUE); /* Nothing to compare, the length must do. */
+}
+
+/* The GET response reports the length of the requested range only. */
+static gdouble _total_length()
+{
+  return ((qmi != NULL)
+          ? content_length
+          : pbar->initial_bytes + content_length);
+}
+
+/*
+ * Check the file on disk against its sidecar. A complete file is
+ * skipped only if the remote one is still the same, a partial file is
+ * resumed only if its checksum matches. Otherwise start over. Without
+ * a sidecar, fall back to comparing the file length (lutil_file_open).
+ */
+static void _chk_sidecar()
+{
+  gdouble n, total;
+
+  lutil_sidecar_clear(&sidecar);
+  sidecar_valid = FALSE;
+
+  if (g->opts.sidecar == FALSE || fo.overwrite_if_exists == TRUE)
+    return;
+
+  if (lutil_sidecar_read(g->result.fpath, &sidecar) != EXIT_SUCCESS)
+    return;
+
+  total = _total_length();
+
+  if (sidecar.content_bytes == total && _validators_match() == TRUE)
+    {
+      if (sidecar.complete == TRUE)
+        {
+          /* The SHA-256 of a skipped file, if it was recorded. */
+          sha_complete = (lutil_sha256_state_from_str(&sha, sidecar.sha256)
+                          == TRUE && sha.n == (guint64) total)
+                         ? TRUE
+                         : FALSE;
+          return; /* lutil_file_open skips it, unless it was truncated. */
+        }
+
+      if (lutil_sidecar_verify(g->result.fpath, &sidecar, &adler, &n,
+                               (g->opts.checksum == TRUE) ? &sha : NULL)
+          == EXIT_SUCCESS
+          && n < total)
+        {
+          sidecar_valid = TRUE;
+          written = n;
+          return;
+        }
+    }
+
+  lutil_sidecar_clear(&sidecar);
+
+  /*
+   * With --resume-from >0, the server sends from the given offset
+   * already: starting over would leave the file without its head.
+   */
+  if (qmi == NULL)
+    return;
+
+  lutil_print_stderr_unless_quiet(
+    _("%s: changed since the last transfer, starting over\n"),
+    g->result.fpath);
+
+  fo.overwrite_if_exists = TRUE;
+}
+
+/*
+ * Set the checksum state to match the file, unless _chk_sidecar did
+ * that already. An appended file without a sidecar is read once.
+ */
+static void _init_checksum()
+{
+  if (g->opts.sidecar == FALSE && g->opts.checksum == FALSE)
+    return;
+
+  if (sidecar_valid == TRUE)
+    return;
+
+  lutil_sha256_init(&sha);
+  adler = 1;
+  written = 0;
+
+  if (fo.result.initial_bytes >0)
+    {
+      struct lutil_sidecar_s s;
+
+      memset(&s, 0, sizeof(struct lutil_sidecar_s));
+      s.adler32 = 1;
+
+      lutil_sidecar_verify(g->result.fpath, &s, &adler, &written, &sha);
+    }
+}
+
+/* --check-space and --preallocate, for the bytes left to write. */
+static gint _chk_space()
+{
+  gdouble n;
+  gchar *d;
+  gint r;
+
+  if (content_length <=0)
+    return (EXIT_SUCCESS);
+
+  /* The GET response reports the length of the requested range only. */
+  n = (qmi != NULL)
+      ? content_length - fo.result.initial_bytes
+      : content_length;
+
+  if (g->opts.space.check == TRUE)
+    {
+      d = g_path_get_dirname(g->result.fpath);
+      r = lutil_file_chk_space(d, n, g->opts.space.margin, g->xperr);
+      g_free(d);
+
+      if (r != EXIT_SUCCESS)
+        return (r);
+    }
+
+  if (g->opts.space.preallocate == TRUE)
+    return (lutil_file_preallocate(&fo, n));
+
+  return (EXIT_SUCCESS);
+}
+
+/*
+ * Record the state of the file for the next run, see _chk_sidecar.
+ * Written as soon as the file is opened, should the transfer be cut
+ * short, and again when it is over, see _interrupted.
+ */
+static void _write_sidecar(const gboolean complete)
+{
+  if (g->opts.sidecar == FALSE || g->result.fpath == NULL)
+    return;
+
+  if (fo.result.file == NULL)
+    return;
+
+  if (resp_etag != NULL)
+    {
+      g_free(sidecar.etag);
+      sidecar.etag = g_strdup(resp_etag);
+    }
+
+  if (resp_last_modified != NULL)
+    {
+      g_free(sidecar.last_modified);
+      sidecar.last_modified = g_strdup(resp_last_modified);
+    }
+
+  sidecar.content_bytes = _total_length();
+
+  g_free(sidecar.sha256);
+  sidecar.sha256 = (g->opts.checksum == TRUE)
+                   ? lutil_sha256_state_to_str(&sha)
+                   : NULL;
+
+  sidecar.complete = complete;
+  sidecar.adler32 = adler;
+  sidecar.bytes = written;
+
+  lutil_sidecar_write(g->result.fpath, &sidecar, g->xperr);
+}
+
 static gint _open_file()
 {
   if (_build_fpath() != EXIT_SUCCESS)
@@ -224,7 +457,11 @@ static gint _open_file()
    * begins.
    */
 
-  if (g->opts.resume_from >= 0)
+  if (restart_retry == TRUE) /* Failed over to a different stream. */
+    fo.overwrite_if_exists = TRUE;
+  else if (resume_retry == TRUE) /* Continue from the bytes written. */
+    fo.overwrite_if_exists = (content_length >0) ? FALSE:TRUE;
+  else if (g->opts.resume_from >= 0)
     fo.overwrite_if_exists = g->opts.overwrite_if_exists;
   else
     fo.overwrite_if_exists = TRUE;
@@ -235,7 +472,21 @@ static gint _open_file()
   fo.fpath = g->result.fpath;
   fo.xperr = g->xperr;
 
-  return (lutil_file_open(&fo));
+  _chk_sidecar();
+
+  if (lutil_file_open(&fo) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  /* Started over: a later retry resumes the new stream, as usual. */
+  restart_retry = FALSE;
+
+  if (_chk_space() != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  _init_checksum();
+  _write_sidecar(FALSE);
+
+  return (EXIT_SUCCESS);
 }
 
 /* Check if transfer was skipped for whatever reason. */
@@ -273,26 +524,211 @@ static gint _chk_file_open()
   return (EXIT_SUCCESS);
 }
 
+/*
+ * The server ignored the range (If-Range): the remote file changed
+ * since the partial file was written. Start over.
+ */
+static gint _chk_range()
+{
+  glong rc;
+
+  if (range_checked == TRUE)
+    return (EXIT_SUCCESS);
+
+  range_checked = TRUE;
+  rc = 0;
+
+  curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &rc);
+  if (rc != 200 || pbar->initial_bytes ==0)
+    return (EXIT_SUCCESS);
+
+  lutil_print_stderr_unless_quiet(
+    _("%s: changed since the last transfer, starting over\n"),
+    g->result.fpath);
+
+  _close_writer();
+
+  fclose(fo.result.file);
+  fo.result.file = fopen(g->result.fpath, "wb");
+
+  if (fo.result.file == NULL)
+    return (EXIT_FAILURE);
+
+  lutil_sidecar_clear(&sidecar);
+  lutil_sha256_init(&sha);
+
+  fo.result.initial_bytes = 0;
+  pbar->initial_bytes = 0;
+  written = 0;
+  adler = 1;
+
+  _write_sidecar(FALSE);
+  return (EXIT_SUCCESS);
+}
+
 static gsize _write_cb(gpointer data, gsize size, gsize nmemb, gpointer udata)
 {
   if (_chk_file_open() != EXIT_SUCCESS)
     return (0);
 
-  if (fwrite(data, size, nmemb, fo.result.file) != nmemb)
+  if (_chk_range() != EXIT_SUCCESS)
     return (_set_io_errmsg());
 
-  if (fflush(fo.result.file) != 0)
+  if (iow == NULL)
+    {
+      iow = lutil_iow_new(fo.result.file, g->opts.page_cache,
+                          g->opts.write_buffer);
+    }
+
+  /* The buffer is full: curl delivers the data again, see _progress_cb. */
+  if (lutil_iow_ready(iow, size*nmemb) == FALSE)
+    {
+      paused = TRUE;
+      return (CURL_WRITEFUNC_PAUSE);
+    }
+
+  lutil_ratelimit_consume(size*nmemb);
+
+  if (lutil_iow_write(iow, data, size*nmemb) != EXIT_SUCCESS)
     return (_set_io_errmsg());
 
+  if (g->opts.sidecar == TRUE)
+    {
+      adler = lutil_adler32(adler, data, size*nmemb);
+      written += size*nmemb;
+    }
+
+  if (g->opts.checksum == TRUE)
+    lutil_sha256_update(&sha, data, size*nmemb);
+
   return (size*nmemb);
 }
 
+/* Return a copy of the value if the header line is the header n. */
+static gchar *_header_value(const gchar *s, const gsize len,
+                            const gchar *n)
+{
+  const gsize l = strlen(n);
+
+  if (len <= l || g_ascii_strncasecmp(s, n, l) !=0 || s[l] != ':')
+    return (NULL);
+
+  return (g_strstrip(g_strndup(s+l+1, len-l-1)));
+}
+
+/* Collect the validators of the (last) response. */
+static gsize _header_cb(gpointer data, gsize size, gsize nmemb,
+                        gpointer udata)
+{
+  const gsize len = size*nmemb;
+  const gchar *s = data;
+  gchar *v;
+
+  if (len >5 && g_ascii_strncasecmp(s, "HTTP/", 5) ==0)
+    {
+      g_free(resp_last_modified);
+      resp_last_modified = NULL;
+
+      g_free(resp_etag);
+      resp_etag = NULL;
+    }
+  else if ((v = _header_value(s, len, "ETag")) != NULL)
+    {
+      g_free(resp_etag);
+      resp_etag = v;
+    }
+  else if ((v = _header_value(s, len, "Last-Modified")) != NULL)
+    {
+      g_free(resp_last_modified);
+      resp_last_modified = v;
+    }
+  return (len);
+}
+
+/* Return TRUE if the program was asked to terminate (SIGINT, SIGTERM). */
+static gboolean _interrupted()
+{
+  return ((g->interrupted != NULL) ? g->interrupted() : FALSE);
+}
+
 static gint _progress_cb(gpointer clientp, gdouble dltotal, gdouble dlnow,
                          gdouble ultotal, gdouble ulnow)
 {
+  if (paused == TRUE && lutil_iow_resume(iow) == TRUE)
+    {
+      paused = FALSE;
+      curl_easy_pause(c, CURLPAUSE_CONT);
+    }
+
+  /* Interrupted: the sidecar is written once the transfer returns. */
+  if (_interrupted() == TRUE)
+    return (1);
+
   return (lpbar_update((lpbar_t) clientp, dlnow));
 }
 
+/* Append the timing of the last request to --stats-file. */
+static void _write_stats(const gchar *kind)
+{
+  struct lutil_curl_stats_s s;
+
+  if (g->opts.stats_file == NULL)
+    return;
+
+  lutil_curl_stats_from(c, &s);
+  lutil_stats_write(g->opts.stats_file, kind, g->result.fpath, &s,
+                    (g_strcmp0(kind, "get") ==0) ? &iow_stats : NULL,
+                    g->xperr);
+}
+
+/* Report the timing of the transfer in the summary and --stats-file. */
+static void _set_timing()
+{
+  struct lutil_curl_stats_s s;
+
+  lutil_curl_share_account(c);
+  lutil_curl_stats_from(c, &s);
+
+  pbar->timing.starttransfer = s.starttransfer_time;
+  pbar->timing.appconnect = s.appconnect_time;
+  pbar->timing.namelookup = s.namelookup_time;
+  pbar->timing.connect = s.connect_time;
+  pbar->timing.total = s.total_time;
+  pbar->timing.redirects = s.redirect_count;
+  pbar->timing.http_version = lutil_curl_http_version_str(s.http_version);
+  pbar->timing.set = TRUE;
+
+  _write_stats("get");
+
+  if (curl_code != CURLE_OK)
+    return;
+
+  lutil_metrics_add(UTIL_METRIC_TRANSFER_BYTES, g->url, s.size_download);
+  lutil_metrics_add(UTIL_METRIC_TRANSFER_SECONDS, g->url, s.total_time);
+  lutil_metrics_add(UTIL_METRIC_TRANSFER_BYTES_PER_SECOND, g->url,
+                    s.speed_download);
+}
+
+/*
+ * libquvi does not pass on the CURLcode of a failed HEAD request. Make
+ * up the nearest one for _retry from the response code of the shared
+ * handle, which libcurl resets for each request.
+ */
+static void _set_head_curl_code()
+{
+  glong rc;
+
+  if (quvi_errcode(g->q) != QUVI_ERROR_CALLBACK) /* Not the network. */
+    return;
+
+  rc = 0;
+  curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &rc);
+
+  curl_code = (rc >0)
+              ? CURLE_HTTP_RETURNED_ERROR
+              : CURLE_COULDNT_CONNECT; /* No response, e.g. timed out */
+}
+
 static gint _chk_autoresume()
 {
   /*
@@ -313,9 +749,27 @@ static gint _chk_autoresume()
    */
 
   lutil_build_fpath_t b = g->build_fpath;
+  gint r;
 
-  if (lutil_query_metainfo(g->q, b->qm, &qmi, b->xperr) != EXIT_SUCCESS)
-    return (EXIT_FAILURE);
+  quvi_http_metainfo_free(qmi); /* Queried again for a retry. */
+  qmi = NULL;
+
+  /* The validators of the HEAD response, see _chk_sidecar. */
+  if (g->opts.sidecar == TRUE)
+    curl_easy_setopt(c, CURLOPT_HEADERFUNCTION, _header_cb);
+
+  r = lutil_query_metainfo(g->q, b->qm, &qmi, b->xperr);
+
+  curl_easy_setopt(c, CURLOPT_HEADERFUNCTION, NULL);
+
+  if (r != EXIT_SUCCESS)
+    {
+      _set_head_curl_code();
+      return (EXIT_FAILURE);
+    }
+
+  lutil_curl_share_account(c);
+  _write_stats("head");
 
   _content_props_from(HTTP_HEAD_RESPONSE);
 
@@ -325,18 +779,55 @@ static gint _chk_autoresume()
   return (EXIT_SUCCESS);
 }
 
+/*
+ * Resume with If-Range if the partial file was verified against its
+ * sidecar: should the remote file have changed, the server responds
+ * with the whole file (200) instead of failing, see _chk_range. Unlike
+ * CURLOPT_RESUME_FROM_LARGE, CURLOPT_RANGE lets the 200 through.
+ */
+static gboolean _set_if_range(const gdouble o)
+{
+  const gchar *v;
+  gchar *s;
+
+  if (sidecar_valid == FALSE || o <=0)
+    return (FALSE);
+
+  /* A weak ETag cannot be used with If-Range. */
+  if (sidecar.etag != NULL && g_str_has_prefix(sidecar.etag, "W/") == FALSE)
+    v = sidecar.etag;
+  else if (sidecar.last_modified != NULL)
+    v = sidecar.last_modified;
+  else
+    return (FALSE);
+
+  s = g_strdup_printf("If-Range: %s", v);
+  if_range = curl_slist_append(if_range, s);
+  g_free(s);
+
+  s = g_strdup_printf("%.0f-", o);
+  curl_easy_setopt(c, CURLOPT_RANGE, s);
+  g_free(s);
+
+  curl_easy_setopt(c, CURLOPT_HTTPHEADER, if_range);
+  return (TRUE);
+}
+
 static gint _setup_curl()
 {
-  if (g->opts.resume_from >= 0) /* 0=auto, >0 from the specified offset. */
+  /* 0=auto, >0 from the specified offset. A retry resumes (auto). */
+  if ((g->opts.resume_from >= 0 || resume_retry == TRUE)
+      && restart_retry == FALSE)
     {
       gdouble o = g->opts.resume_from;
-      if (g->opts.resume_from ==0)
+      if (g->opts.resume_from ==0 || resume_retry == TRUE)
         {
           if (_chk_autoresume() != EXIT_SUCCESS)
             return (EXIT_FAILURE);
           o = fo.result.initial_bytes;
         }
-      curl_easy_setopt(c, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) o);
+      if (_set_if_range(o) == FALSE)
+        curl_easy_setopt(c, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) o);
       pbar->initial_bytes = o;
     }
 
@@ -354,9 +845,27 @@ static gint _setup_curl()
   curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, _write_cb);
   curl_easy_setopt(c, CURLOPT_URL, g->url);
 
+  if (g->opts.sidecar == TRUE)
+    curl_easy_setopt(c, CURLOPT_HEADERFUNCTION, _header_cb);
+
   curl_easy_setopt(c, CURLOPT_ENCODING, "identity");
   curl_easy_setopt(c, CURLOPT_HEADER, 0L);
 
+  /* The transfer is throttled by lutil_ratelimit, see _write_cb. */
+  curl_easy_setopt(c, CURLOPT_MAX_RECV_SPEED_LARGE, (curl_off_t) 0);
+
+  /* Do not write the error page to the file, it could not be resumed. */
+  curl_easy_setopt(c, CURLOPT_FAILONERROR, 1L);
+
+  /* Abort a stalled transfer, see _failover. */
+  if (g->opts.stall.speed >0)
+    {
+      curl_easy_setopt(c, CURLOPT_LOW_SPEED_LIMIT,
+                       (glong) g->opts.stall.speed * 1024);
+      curl_easy_setopt(c, CURLOPT_LOW_SPEED_TIME,
+                       (glong) g->opts.stall.time);
+    }
+
   curl_easy_setopt(c, CURLOPT_PROGRESSFUNCTION, _progress_cb);
   curl_easy_setopt(c, CURLOPT_PROGRESSDATA, pbar);
   curl_easy_setopt(c, CURLOPT_NOPROGRESS, 0L);
@@ -367,13 +876,27 @@ static gint _setup_curl()
 static void _reset_curl()
 {
   curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, NULL);
+  curl_easy_setopt(c, CURLOPT_FAILONERROR, 0L);
   curl_easy_setopt(c, CURLOPT_ENCODING, "");
 
+  curl_easy_setopt(c, CURLOPT_LOW_SPEED_LIMIT, 0L);
+  curl_easy_setopt(c, CURLOPT_LOW_SPEED_TIME, 0L);
+
   curl_easy_setopt(c, CURLOPT_PROGRESSFUNCTION, NULL);
   curl_easy_setopt(c, CURLOPT_PROGRESSDATA, NULL);
   curl_easy_setopt(c, CURLOPT_NOPROGRESS, 1L);
 
   curl_easy_setopt(c, CURLOPT_RESUME_FROM_LARGE, 0L);
+
+  curl_easy_setopt(c, CURLOPT_MAX_RECV_SPEED_LARGE,
+                   (curl_off_t) g->opts.throttle * 1024);
+
+  curl_easy_setopt(c, CURLOPT_HEADERFUNCTION, NULL);
+  curl_easy_setopt(c, CURLOPT_HTTPHEADER, NULL);
+  curl_easy_setopt(c, CURLOPT_RANGE, NULL);
+
+  curl_slist_free_all(if_range);
+  if_range = NULL;
 }
 
 static gint _open_stream()
@@ -388,13 +911,32 @@ static gint _open_stream()
       return (EXIT_FAILURE);
     }
 
+  memset(&iow_stats, 0, sizeof(struct lutil_iow_stats_s));
+  curl_code = CURLE_OK; /* Of this attempt, see _retry. */
+  range_checked = FALSE;
+  paused = FALSE;
+
   pbar = lpbar_new();
+  pbar->queue.pos = g->queue.pos;
+  pbar->queue.len = g->queue.len;
   r = _setup_curl();
 
   if (r == EXIT_SUCCESS)
     {
+      lutil_trace_begin("quvi", "transfer", g->url);
       curl_code = curl_easy_perform(c);
+      lutil_trace_end("quvi", "transfer");
+
+      /* The sidecar must not record the bytes still being written. */
+      if (_close_writer() != EXIT_SUCCESS && curl_code == CURLE_OK)
+        {
+          curl_code = CURLE_WRITE_ERROR;
+          _set_io_errmsg();
+        }
+
       r = _chk_transfer_errors(c);
+      _write_sidecar((r == EXIT_SUCCESS) ? TRUE:FALSE);
+      _set_timing();
       _reset_curl();
     }
 
@@ -402,38 +944,150 @@ static gint _open_stream()
   return (r);
 }
 
-static gint _exec_cmd()
+/* Advance to the stream with the ID, return FALSE if there is none. */
+static gboolean _find_stream(quvi_media_t qm, const gchar *id)
+{
+  while (quvi_media_stream_next(qm) == QUVI_TRUE)
+    {
+      gchar *s = NULL;
+      quvi_media_get(qm, QUVI_MEDIA_STREAM_PROPERTY_ID, &s);
+      if (g_strcmp0(s, id) ==0)
+        return (TRUE);
+    }
+  return (FALSE);
+}
+
+/*
+ * Resolve the media URL again after a stall, e.g. for a different CDN
+ * edge. The same stream is resumed. If the stream is no longer there,
+ * choose another (--stream, --stream-policy), and restart the transfer
+ * instead.
+ */
+static gboolean _failover()
 {
-  struct lutil_exec_opts_s xopts;
-  gint i, r;
+  quvi_media_t qm;
+  gchar *id, *u;
 
-  if (g->opts.exec.external == NULL)
-    return (EXIT_SUCCESS);
+  if (g->input_url == NULL)
+    return (FALSE);
 
-  for (i=0, r=EXIT_SUCCESS;
-       g->opts.exec.external[i] != NULL && r == EXIT_SUCCESS;
-       ++i)
+  id = NULL;
+  quvi_media_get(g->build_fpath->qm, QUVI_MEDIA_STREAM_PROPERTY_ID, &id);
+  id = g_strdup(id);
+
+  lutil_trace_begin("quvi", "query", g->input_url);
+  qm = quvi_media_new(g->q, g->input_url);
+  lutil_trace_end("quvi", "query");
+
+  if (quvi_ok(g->q) == QUVI_FALSE)
     {
-      memset(&xopts, 0, sizeof(struct lutil_exec_opts_s));
+      g->xperr(_("libquvi: while parsing media properties: %s"),
+               quvi_errmsg(g->q));
+      quvi_media_free(qm);
+      g_free(id);
+      return (FALSE);
+    }
+
+  if (_find_stream(qm, id) == FALSE)
+    {
+      if ((g->opts.stream == NULL && g->opts.stream_policy == NULL)
+          || lget_choose_stream(g, qm) != EXIT_SUCCESS)
+        {
+          quvi_media_free(qm);
+          g_free(id);
+          return (FALSE);
+        }
+      restart_retry = TRUE;
+    }
+  g_free(id);
 
-      xopts.flags.discard_stderr = !g->opts.exec.enable_stderr;
-      xopts.flags.discard_stdout = !g->opts.exec.enable_stdout;
-      xopts.flags.dump_argv = g->opts.exec.dump_argv;
+  if (qm_failover != NULL)
+    quvi_media_free(qm_failover);
 
-      xopts.exec_arg = g->opts.exec.external[i];
-      xopts.xperr = g->xperr;
+  qm_failover = qm;
+  g->build_fpath->qm = qm;
 
-      xopts.fpath = g->result.fpath;
-      xopts.qm = g->build_fpath->qm;
+  u = NULL;
+  quvi_media_get(qm, QUVI_MEDIA_STREAM_PROPERTY_URL, &u);
+  g->url = u;
 
-      r = lutil_exec_cmd(&xopts);
+  return (TRUE);
+}
+
+/*
+ * Check whether the failed transfer should be retried, and wait before
+ * the retry. The retry resumes the transfer if the file was opened.
+ */
+static gboolean _retry(const gint n)
+{
+  glong rc;
+  gulong d;
+
+  if (n > g->opts.retry.attempts || transfer_skipped == TRUE
+      || _interrupted() == TRUE)
+    {
+      return (FALSE);
+    }
+
+  if (c == NULL)
+    return (FALSE);
+
+  rc = 0;
+  curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &rc);
+
+  if (lget_retry_is_transient(curl_code, rc) == FALSE)
+    return (FALSE);
+
+  if (fo.result.file != NULL)
+    {
+      _close_writer();
+      fclose(fo.result.file);
+      fo.result.file = NULL;
+      resume_retry = TRUE;
+    }
+
+  lpbar_free(pbar);
+  pbar = NULL;
+
+  /* Stalled: retry at once if the URL was resolved again. */
+  if (curl_code == CURLE_OPERATION_TIMEDOUT && g->opts.stall.speed >0)
+    {
+      lutil_print_stderr_unless_quiet(_("retry %d/%d: transfer stalled, "
+                                        "resolving the media URL "
+                                        "again\n"),
+                                      n, g->opts.retry.attempts);
+      if (_failover() == TRUE)
+        return (TRUE);
+    }
+
+  d = lget_retry_delay(g, n);
+  lutil_print_stderr_unless_quiet(_("retry %d/%d in %.1fs\n"), n,
+                                  g->opts.retry.attempts,
+                                  (gdouble) d / G_USEC_PER_SEC);
+  g_usleep(d);
+
+  return (TRUE);
+}
+
+/* Set the SHA-256 of the file, and append it to the manifest. */
+static void _set_checksum()
+{
+  if (g->opts.checksum == FALSE || g->result.fpath == NULL)
+    return;
+
+  g->result.checksum = lutil_sha256_hex(&sha);
+
+  if (g->opts.checksum_manifest != NULL)
+    {
+      lutil_sha256_manifest_append(g->opts.checksum_manifest,
+                                   g->result.checksum, g->result.fpath,
+                                   g->xperr);
     }
-  return (r);
 }
 
 gint lget_http_get(lget_t handle)
 {
-  gint r;
+  gint n, r;
 
   memset(&fo, 0, sizeof(struct lutil_file_open_s));
 
@@ -451,20 +1105,46 @@ gint lget_http_get(lget_t handle)
 
   force_skip_transfer = g->opts.skip_transfer;
   transfer_skipped = FALSE;
+  restart_retry = FALSE;
+  resume_retry = FALSE;
+  qm_failover = NULL;
+
+  memset(&sidecar, 0, sizeof(struct lutil_sidecar_s));
+  lutil_sha256_init(&sha);
+  sha_complete = FALSE;
+  resp_last_modified = NULL;
+  sidecar_valid = FALSE;
+  resp_etag = NULL;
+  if_range = NULL;
+  written = 0;
+  adler = 1;
 
   /*
    * If the media stream was retrieved completely already:
    *  lutil_open_file will set the 'skip_retrieved_already' flag, and
    *  return EXIT_FAILURE.
    */
-  r = _open_stream();
+  for (n=1;; ++n)
+    {
+      r = _open_stream();
+      if (r == EXIT_SUCCESS || _retry(n) == FALSE)
+        break;
+    }
+
+  if (r == EXIT_SUCCESS
+      || (fo.result.skip_retrieved_already == TRUE && sha_complete == TRUE))
+    {
+      _set_checksum();
+    }
   if (r == EXIT_SUCCESS || fo.result.skip_retrieved_already == TRUE)
-    r = _exec_cmd();
+    r = lget_exec(g);
 
   /* --skip-transfer was specified. */
   if (transfer_skipped == TRUE)
     r = EXIT_SUCCESS;
 
+  g->result.skipped = transfer_skipped;
+
   return (_cleanup(r));
 }
 
@@ -21,12 +21,159 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <glib/gi18n.h>
 #include <quvi.h>
 
 #include "lutil.h"
 #include "lget.h"
 
+/* Choose the stream, --stream-policy overrides --stream. */
+gint lget_choose_stream(lget_t g, gpointer qm)
+{
+  if (g->opts.stream_policy != NULL)
+    {
+      return (lutil_policy_choose(g->opts.stream_policy, g->q, qm,
+                                  g->xperr));
+    }
+  else if (g->opts.stream != NULL)
+    return (lutil_choose_stream(g->q, qm, g->opts.stream, g->xperr));
+
+  return (EXIT_SUCCESS);
+}
+
+/* Link the new file path to the one found from the index. */
+static gchar *_index_link(lget_t g, const gchar *found)
+{
+  gchar *fpath, *fname, *ext;
+
+  fname = g_path_get_basename(found);
+  ext = strrchr(fname, '.');
+
+  g->build_fpath->file_ext = (ext != NULL) ? ext+1:"";
+  fpath = lutil_build_fpath(g->build_fpath);
+  g->build_fpath->file_ext = NULL;
+
+  g_free(fname);
+
+  if (fpath == NULL || g_strcmp0(fpath, found) ==0)
+    return (fpath);
+
+  if (g_file_test(fpath, G_FILE_TEST_EXISTS) == TRUE)
+    {
+      if (g->opts.overwrite_if_exists == FALSE)
+        return (fpath);
+      g_unlink(fpath);
+    }
+
+  if (link(found, fpath) !=0)
+    {
+      gchar *e = lutil_strerror();
+      g->xperr(_("while linking %s to %s: %s"), fpath, found, e);
+      g_free(e);
+      g_free(fpath);
+      return (NULL);
+    }
+  return (fpath);
+}
+
+/*
+ * Check the media-ID index for the media stream, saved from another
+ * URL already. Returns TRUE if the media stream need not be retrieved.
+ */
+static gboolean _chk_index(lget_t g)
+{
+  const gchar *media_id, *stream_id;
+  gchar *domain, *found;
+
+  if (lutil_index_enabled() == FALSE)
+    return (FALSE);
+
+  quvi_media_get(g->qm, QUVI_MEDIA_STREAM_PROPERTY_ID, &stream_id);
+  quvi_media_get(g->qm, QUVI_MEDIA_PROPERTY_ID, &media_id);
+
+  domain = lutil_url_host(g->input_url);
+  found = lutil_index_lookup(domain, media_id, stream_id);
+  g_free(domain);
+
+  if (found == NULL)
+    return (FALSE);
+
+  if (g->opts.index_link == TRUE)
+    g->result.fpath = _index_link(g, found);
+
+  if (g->result.fpath == NULL) /* Skip, or linking failed. */
+    {
+      g_print(_("skip <transfer>: %s (indexed)\n"), found);
+      g->result.fpath = found;
+    }
+  else
+    {
+      g_print(_("skip <transfer>: %s (indexed: %s)\n"),
+              g->result.fpath, found);
+      g_free(found);
+    }
+
+  g->result.skipped = TRUE;
+  return (TRUE);
+}
+
+/* Record the saved media stream in the media-ID index. */
+static void _index_add(lget_t g)
+{
+  const gchar *media_id, *stream_id;
+  gchar *domain;
+
+  if (lutil_index_enabled() == FALSE || g->result.fpath == NULL
+      || g->opts.skip_transfer == TRUE)
+    {
+      return;
+    }
+
+  if (g_file_test(g->result.fpath, G_FILE_TEST_IS_REGULAR) == FALSE)
+    return;
+
+  quvi_media_get(g->qm, QUVI_MEDIA_STREAM_PROPERTY_ID, &stream_id);
+  quvi_media_get(g->qm, QUVI_MEDIA_PROPERTY_ID, &media_id);
+
+  domain = lutil_url_host(g->input_url);
+  lutil_index_add(domain, media_id, stream_id, g->result.fpath);
+  g_free(domain);
+}
+
+/* Run the --exec commands for the saved (or skipped) media file. */
+gint lget_exec(const lget_t g)
+{
+  struct lutil_exec_opts_s xopts;
+  gint i, r;
+
+  if (g->opts.exec.external == NULL)
+    return (EXIT_SUCCESS);
+
+  for (i=0, r=EXIT_SUCCESS;
+       g->opts.exec.external[i] != NULL && r == EXIT_SUCCESS;
+       ++i)
+    {
+      memset(&xopts, 0, sizeof(struct lutil_exec_opts_s));
+
+      xopts.flags.discard_stderr = !g->opts.exec.enable_stderr;
+      xopts.flags.discard_stdout = !g->opts.exec.enable_stdout;
+      xopts.flags.dump_argv = g->opts.exec.dump_argv;
+
+      xopts.exec_arg = g->opts.exec.external[i];
+      xopts.xperr = g->xperr;
+
+      xopts.checksum = g->result.checksum;
+      xopts.fpath = g->result.fpath;
+      xopts.qm = g->build_fpath->qm;
+
+      r = lutil_exec_cmd(&xopts);
+    }
+  return (r);
+}
+
 gint lget_new(lget_t g)
 {
   gchar *s;
@@ -39,12 +186,13 @@ gint lget_new(lget_t g)
   g_assert(g->qm != NULL);
   g_assert(g->q != NULL);
 
-  if (g->opts.stream != NULL)
-    {
-      r = lutil_choose_stream(g->q, g->qm, g->opts.stream, g->xperr);
-      if (r != EXIT_SUCCESS)
-        return (EXIT_FAILURE);
-    }
+  if (lget_choose_stream(g, g->qm) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  /* As with a file retrieved already, see lget_http_get. */
+  if (_chk_index(g) == TRUE)
+    return (lget_exec(g));
+
   quvi_media_get(g->qm, QUVI_MEDIA_STREAM_PROPERTY_URL, &g->url);
 
   s = g_uri_parse_scheme(g->url);
@@ -60,6 +208,10 @@ gint lget_new(lget_t g)
         g->xperr(_("protocol `%s' is not supported"), s);
     }
   g_free(s);
+
+  if (r == EXIT_SUCCESS)
+    _index_add(g);
+
   return (r);
 }
 
@@ -68,6 +220,7 @@ void lget_free(lget_t g)
   if (g == NULL)
     return;
 
+  g_free(g->result.checksum);
   g_free(g->result.fpath);
 }
 
@@ -25,20 +25,55 @@ struct lget_s
 {
   lutil_build_fpath_t build_fpath;
   lutil_cb_printerr xperr;
+  gboolean (*interrupted)(); /* Abort the transfer, if TRUE */
+  const gchar *input_url; /* Resolved again after a stall. */
   gpointer qm;
   gpointer q;
   gchar *url;
   struct
   {
+    guint pos; /* 1-based, 0 if not scheduled */
+    guint len;
+  } queue; /* --schedule */
+  struct
+  {
+    gchar *checksum; /* SHA-256, if --checksum */
+    gboolean skipped;
     gchar *fpath;
   } result;
   struct
   {
     gboolean overwrite_if_exists;
+    const gchar *checksum_manifest;
     gboolean skip_transfer;
+    gboolean index_link; /* Hard link, instead of skip, on index hit */
+    gboolean checksum;
+    gboolean sidecar;
+    const gchar *stats_file;
+    lutil_policy_t stream_policy;
+    lutilPageCache page_cache;
+    gsize write_buffer; /* bytes, 0=write in the callback */
+    gint throttle; /* Ki/s, of the requests other than the transfer */
     gdouble resume_from;
     gchar *stream;
     struct
+    {
+      gboolean preallocate;
+      gdouble margin; /* bytes */
+      gboolean check;
+    } space;
+    struct
+    {
+      gint speed; /* Ki/s, 0=disabled */
+      gint time; /* seconds */
+    } stall;
+    struct
+    {
+      gint max_delay; /* seconds */
+      gint attempts;
+      gint delay; /* seconds */
+    } retry;
+    struct
     {
       const gchar **external;
       gboolean enable_stderr;
@@ -53,7 +88,12 @@ typedef struct lget_s *lget_t;
 void lget_free(lget_t);
 gint lget_new(lget_t);
 
+gint lget_choose_stream(lget_t, gpointer);
 gint lget_http_get(lget_t);
+gint lget_exec(const lget_t);
+
+gboolean lget_retry_is_transient(const glong, const glong);
+gulong lget_retry_delay(const lget_t, const gint);
 
 #endif /* lget_h */
 
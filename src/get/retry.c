@@ -0,0 +1,85 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "lutil.h"
+#include "lget.h"
+
+/* Return TRUE if the transfer error is likely to go away on its own. */
+gboolean lget_retry_is_transient(const glong curl_code,
+                                 const glong response_code)
+{
+  switch (curl_code)
+    {
+    case CURLE_HTTP_RETURNED_ERROR:
+      return ((response_code == 408
+               || response_code == 429
+               || response_code >= 500) ? TRUE:FALSE);
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+#if LIBCURL_VERSION_NUM >= 0x072600
+    case CURLE_HTTP2:
+#endif
+#if LIBCURL_VERSION_NUM >= 0x073100
+    case CURLE_HTTP2_STREAM:
+#endif
+      return (TRUE);
+    default:
+      break;
+    }
+  return (FALSE);
+}
+
+/*
+ * Return the delay (microseconds) before the retry n (1..): the delay
+ * doubles with each retry up to the max. delay, and the half of it is
+ * random, so that the concurrent transfers do not retry in lockstep.
+ */
+gulong lget_retry_delay(const lget_t g, const gint n)
+{
+  gdouble d;
+  gint i;
+
+  g_assert(g != NULL);
+  g_assert(n >0);
+
+  d = g->opts.retry.delay;
+  for (i=1; i<n && d < g->opts.retry.max_delay; ++i)
+    d *= 2;
+
+  if (d > g->opts.retry.max_delay)
+    d = g->opts.retry.max_delay;
+
+  d = d/2 + g_random_double_range(0, d/2);
+  return ((gulong) (d * G_USEC_PER_SEC));
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -80,6 +80,46 @@ static gchar *_read_file(const gchar *fpath)
 
 static gint _extract_uris(linput_t, const gchar*);
 
+/* Add the URL, followed by an optional priority column. */
+static gint _add_url(linput_t p, const gchar *s)
+{
+  gchar **v;
+  gint r;
+
+  v = g_strsplit_set(s, " \t", 2);
+  r = EXIT_SUCCESS;
+
+  if (v[1] != NULL && strlen(g_strstrip(v[1])) >0)
+    {
+      gint64 n;
+      gchar *e;
+
+      n = g_ascii_strtoll(v[1], &e, 10);
+      if (*e != '\0' || n < G_MININT || n > G_MAXINT)
+        {
+          g_printerr(_("error: %s: an invalid priority\n"), v[1]);
+          r = EXIT_FAILURE;
+        }
+      else
+        {
+          if (p->url.priority == NULL)
+            {
+              p->url.priority =
+                g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      g_free, NULL);
+            }
+          g_hash_table_replace(p->url.priority, g_strdup(v[0]),
+                               GINT_TO_POINTER((gint) n));
+        }
+    }
+
+  if (r == EXIT_SUCCESS)
+    p->url.input = lutil_slist_prepend_if_unique(p->url.input, v[0]);
+
+  g_strfreev(v);
+  return (r);
+}
+
 static gint _read_from_uri(linput_t p, const gchar *u)
 {
   GError *e;
@@ -130,7 +170,7 @@ static gint _determine_input(linput_t p, const gboolean try_read_as_file,
         r = EXIT_FAILURE;
     }
   else if (g_strcmp0(c, "http") ==0 || g_strcmp0(c, "https") ==0)
-    p->url.input = lutil_slist_prepend_if_unique(p->url.input, s);
+    r = _add_url(p, s);
   else if (g_strcmp0(c, "file") ==0)
     r = _read_from_uri(p, s);
   else
@@ -200,6 +240,10 @@ void linput_free(linput_t linput)
 {
   lutil_slist_free_full(linput->url.input, (GFunc) g_free);
   linput->url.input = NULL;
+
+  if (linput->url.priority != NULL)
+    g_hash_table_destroy(linput->url.priority);
+  linput->url.priority = NULL;
 }
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
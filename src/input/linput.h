@@ -25,6 +25,7 @@ struct linput_s
 {
   struct
   {
+    GHashTable *priority; /* URL -> priority column, if any */
     GSList *input;
   } url;
 };
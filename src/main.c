@@ -26,6 +26,7 @@
 #include <glib/gi18n.h>
 #include <quvi.h>
 
+#include "lutil.h"
 #include "opts.h"
 #include "cmd.h"
 
@@ -83,6 +84,9 @@ static const struct builtin_cmd_s builtin_cmds[] =
   {"get", N_("Save media stream to a file"), cmd_get},
   {"info", N_("Inspect the configuration and the script properties"), cmd_info},
   {"scan", N_("Scan and print the found embedded media URLs"), cmd_scan},
+#ifdef HAVE_SERVE
+  {"serve", N_("Serve dump, get and scan requests over a socket"), cmd_serve},
+#endif
   /* version */
   {"--version", "", _cmd_version},
   {"-v", "",        _cmd_version},
@@ -187,8 +191,12 @@ static void _opts_free()
 
   g_free(opts.core.subtitle_export_format);
   g_free(opts.core.subtitle_language);
+  g_free(opts.core.metrics_file);
+  g_free(opts.core.stats_file);
+  g_free(opts.core.trace_file);
   g_free(opts.core.print_format);
   g_free(opts.core.verbosity);
+  g_free(opts.core.stream_policy);
   g_free(opts.core.stream);
 
   /* exec */
@@ -200,12 +208,30 @@ static void _opts_free()
   g_strfreev(opts.get.output_regex);
   g_free(opts.get.output_name);
   g_free(opts.get.output_file);
+  g_free(opts.get.output_shard);
   g_free(opts.get.output_dir);
+  g_free(opts.get.checksum_manifest);
+  g_free(opts.get.checksum);
+  g_free(opts.get.index_action);
+  g_free(opts.get.index_file);
+  g_free(opts.get.page_cache);
+  g_free(opts.get.schedule);
+  g_free(opts.get.throttle_schedule);
+  g_free(opts.get.throttle_file);
 
   /* http */
 
+  g_free(opts.http.http_version);
   g_free(opts.http.user_agent);
 
+  /* scan */
+
+  g_free(opts.scan.then);
+
+  /* serve */
+
+  g_free(opts.serve.socket);
+
   /* other */
 
   g_strfreev(opts.rargs);
@@ -215,6 +241,11 @@ static void _opts_free()
 
 static gint _cleanup()
 {
+  lutil_metrics_close();
+  lutil_trace_close();
+  lutil_ratelimit_close();
+  lutil_index_close();
+  lutil_curl_share_free();
   _opts_free();
 
   g_free(argv0);
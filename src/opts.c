@@ -34,6 +34,14 @@ const GOptionEntry option_entries[] =
     "check-mode-offline", 'o', 0, G_OPTION_ARG_NONE,
     &opts.core.check_mode_offline, NULL, NULL
   },
+  {
+    "metrics-file", 0, 0, G_OPTION_ARG_FILENAME, &opts.core.metrics_file,
+    NULL, NULL
+  },
+  {
+    "metrics-interval", 0, 0, G_OPTION_ARG_INT,
+    &opts.core.metrics_interval, NULL, NULL
+  },
   {
     "print-format", 'p', 0, G_OPTION_ARG_STRING, &opts.core.print_format,
     NULL, NULL
@@ -54,10 +62,22 @@ const GOptionEntry option_entries[] =
     "subtitle-language", 'l', 0, G_OPTION_ARG_STRING,
     &opts.core.subtitle_language, NULL, NULL
   },
+  {
+    "stats-file", 0, 0, G_OPTION_ARG_FILENAME, &opts.core.stats_file,
+    NULL, NULL
+  },
   {
     "stream", 's', 0, G_OPTION_ARG_STRING, &opts.core.stream,
     NULL, NULL
   },
+  {
+    "stream-policy", 0, 0, G_OPTION_ARG_STRING, &opts.core.stream_policy,
+    NULL, NULL
+  },
+  {
+    "trace-file", 0, 0, G_OPTION_ARG_FILENAME, &opts.core.trace_file,
+    NULL, NULL
+  },
   {
     "verbosity", 'b', 0, G_OPTION_ARG_STRING, &opts.core.verbosity,
     NULL, NULL
@@ -101,6 +121,10 @@ const GOptionEntry option_entries[] =
     "output-dir", 'i', 0, G_OPTION_ARG_STRING, &opts.get.output_dir,
     NULL, NULL
   },
+  {
+    "output-shard", 0, 0, G_OPTION_ARG_STRING, &opts.get.output_shard,
+    NULL, NULL
+  },
   {
     "overwrite", 'w', 0, G_OPTION_ARG_NONE, &opts.get.overwrite,
     NULL, NULL
@@ -113,10 +137,83 @@ const GOptionEntry option_entries[] =
     "resume-from", 'r', 0, G_OPTION_ARG_DOUBLE, &opts.get.resume_from,
     NULL, NULL
   },
+  {
+    "checksum", 0, 0, G_OPTION_ARG_STRING, &opts.get.checksum, NULL, NULL
+  },
+  {
+    "checksum-manifest", 0, 0, G_OPTION_ARG_FILENAME,
+    &opts.get.checksum_manifest, NULL, NULL
+  },
+  {
+    "write-buffer", 0, 0, G_OPTION_ARG_INT, &opts.get.write_buffer,
+    NULL, NULL
+  },
+  {
+    "page-cache", 0, 0, G_OPTION_ARG_STRING, &opts.get.page_cache,
+    NULL, NULL
+  },
+  {
+    "check-space", 0, 0, G_OPTION_ARG_NONE, &opts.get.check_space,
+    NULL, NULL
+  },
+  {
+    "space-margin", 0, 0, G_OPTION_ARG_INT, &opts.get.space_margin,
+    NULL, NULL
+  },
+  {
+    "preallocate", 0, 0, G_OPTION_ARG_NONE, &opts.get.preallocate,
+    NULL, NULL
+  },
+  {
+    "schedule", 0, 0, G_OPTION_ARG_STRING, &opts.get.schedule, NULL, NULL
+  },
+  {
+    "index-file", 0, 0, G_OPTION_ARG_FILENAME, &opts.get.index_file,
+    NULL, NULL
+  },
+  {
+    "index-action", 0, 0, G_OPTION_ARG_STRING, &opts.get.index_action,
+    NULL, NULL
+  },
+  {
+    "resume-sidecar", 0, 0, G_OPTION_ARG_NONE, &opts.get.resume_sidecar,
+    NULL, NULL
+  },
   {
     "throttle", 't', 0, G_OPTION_ARG_INT, &opts.get.throttle,
     NULL, NULL
   },
+  {
+    "retry", 0, 0, G_OPTION_ARG_INT, &opts.get.retry, NULL, NULL
+  },
+  {
+    "retry-delay", 0, 0, G_OPTION_ARG_INT, &opts.get.retry_delay,
+    NULL, NULL
+  },
+  {
+    "retry-max-delay", 0, 0, G_OPTION_ARG_INT, &opts.get.retry_max_delay,
+    NULL, NULL
+  },
+  {
+    "stall-speed", 0, 0, G_OPTION_ARG_INT, &opts.get.stall_speed,
+    NULL, NULL
+  },
+  {
+    "stall-time", 0, 0, G_OPTION_ARG_INT, &opts.get.stall_time,
+    NULL, NULL
+  },
+  {
+    "throttle-schedule", 0, 0, G_OPTION_ARG_STRING,
+    &opts.get.throttle_schedule, NULL, NULL
+  },
+  {
+    "throttle-file", 0, 0, G_OPTION_ARG_FILENAME, &opts.get.throttle_file,
+    NULL, NULL
+  },
+  {
+    "playlist-prefetch", 0, 0, G_OPTION_ARG_INT,
+    &opts.get.playlist_prefetch, NULL, NULL
+  },
   /* http */
   {
     "enable-cookies", 'c', 0, G_OPTION_ARG_NONE, &opts.http.enable_cookies,
@@ -126,6 +223,40 @@ const GOptionEntry option_entries[] =
     "user-agent", 'u', 0, G_OPTION_ARG_STRING, &opts.http.user_agent,
     NULL, NULL
   },
+  {
+    "http-version", 0, 0, G_OPTION_ARG_STRING, &opts.http.http_version,
+    NULL, NULL
+  },
+  /* scan */
+  {
+    "crawl-depth", 0, 0, G_OPTION_ARG_INT, &opts.scan.crawl_depth,
+    NULL, NULL
+  },
+  {
+    "crawl-host-budget", 0, 0, G_OPTION_ARG_INT,
+    &opts.scan.crawl_host_budget, NULL, NULL
+  },
+  {
+    "scan-jobs", 0, 0, G_OPTION_ARG_INT, &opts.scan.jobs,
+    NULL, NULL
+  },
+  {
+    "then", 0, 0, G_OPTION_ARG_STRING, &opts.scan.then,
+    NULL, NULL
+  },
+  /* serve */
+  {
+    "serve-socket", 0, 0, G_OPTION_ARG_FILENAME, &opts.serve.socket,
+    NULL, NULL
+  },
+  {
+    "serve-handles", 0, 0, G_OPTION_ARG_INT, &opts.serve.handles,
+    NULL, NULL
+  },
+  {
+    "serve-port", 0, 0, G_OPTION_ARG_INT, &opts.serve.port,
+    NULL, NULL
+  },
   /* remaining */
   {
     G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &opts.rargs,
@@ -147,6 +278,51 @@ static const gchar *dumpformat_possible_values[] =
   NULL
 };
 
+static const gchar *output_shard_possible_values[] =
+{
+  "none",
+  "hash",
+  "prefix",
+  NULL
+};
+
+static const gchar *page_cache_possible_values[] =
+{
+  "keep",
+  "dontneed",
+  "direct",
+  NULL
+};
+
+static const gchar *schedule_possible_values[] =
+{
+  "input",
+  "size",
+  "priority",
+  NULL
+};
+
+static const gchar *index_action_possible_values[] =
+{
+  "skip",
+  "link",
+  NULL
+};
+
+static const gchar *checksum_possible_values[] =
+{
+  "none",
+  "sha256",
+  NULL
+};
+
+static const gchar *then_possible_values[] =
+{
+  "dump",
+  "get",
+  NULL
+};
+
 static gint cb_chk_str(const gchar *fpath, const gchar *opt_name,
                        const gchar *opt_val, const gchar **ok_strv)
 {
@@ -191,10 +367,104 @@ static gint cb_chk_throttle(const gchar *fpath,
   return (r);
 }
 
+static gint cb_chk_int_range(const gchar *fpath, const gchar *opt_name,
+                             const gint opt_val, const gint min,
+                             const gint max)
+{
+  gint r = EXIT_SUCCESS;
+  if (opt_val <min || opt_val >max)
+    {
+      gchar *s = g_strdup_printf("%d", opt_val);
+      lopts_invalid_value(opt_name, fpath, s, NULL);
+      r = EXIT_FAILURE;
+      g_free(s);
+    }
+  return (r);
+}
+
+static gint cb_chk_metrics_interval(const gchar *fpath,
+                                    const gchar *opt_name,
+                                    const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 86400));
+}
+
+static gint cb_chk_playlist_prefetch(const gchar *fpath,
+                                     const gchar *opt_name,
+                                     const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 32));
+}
+
+static gint cb_chk_retry(const gchar *fpath,
+                         const gchar *opt_name,
+                         const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 100));
+}
+
+static gint cb_chk_retry_delay(const gchar *fpath,
+                               const gchar *opt_name,
+                               const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 3600));
+}
+
+static gint cb_chk_write_buffer(const gchar *fpath,
+                                const gchar *opt_name,
+                                const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 1024));
+}
+
+static gint cb_chk_space_margin(const gchar *fpath,
+                                const gchar *opt_name,
+                                const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 1048576));
+}
+
+static gint cb_chk_scan_jobs(const gchar *fpath,
+                             const gchar *opt_name,
+                             const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 32));
+}
+
+static gint cb_chk_crawl_depth(const gchar *fpath,
+                               const gchar *opt_name,
+                               const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 16));
+}
+
+static gint cb_chk_crawl_host_budget(const gchar *fpath,
+                                     const gchar *opt_name,
+                                     const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, G_MAXINT));
+}
+
+static gint cb_chk_serve_handles(const gchar *fpath,
+                                 const gchar *opt_name,
+                                 const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 64));
+}
+
+static gint cb_chk_serve_port(const gchar *fpath,
+                              const gchar *opt_name,
+                              const gint opt_val)
+{
+  return (cb_chk_int_range(fpath, opt_name, opt_val, 0, 65535));
+}
+
 static const gchar g_core[] = "core";
 static const gchar g_dump[] = "dump";
 static const gchar g_exec[] = "exec";
 static const gchar g_http[] = "http";
+static const gchar g_serve[] = "serve";
+static const gchar g_scan[] = "scan";
 static const gchar g_get[] = "get";
 
 void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
@@ -215,9 +485,24 @@ void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
   lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
                         "subtitle-language", &opts.core.subtitle_language);
 
+  lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
+                        "metrics-file", &opts.core.metrics_file);
+
+  lopts_keyfile_get_int(kf, cb_chk_metrics_interval, fpath, g_core,
+                        "metrics-interval", &opts.core.metrics_interval);
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
+                        "stats-file", &opts.core.stats_file);
+
   lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
                         "stream", &opts.core.stream);
 
+  lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
+                        "stream-policy", &opts.core.stream_policy);
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_core, NULL,
+                        "trace-file", &opts.core.trace_file);
+
   lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_core,
                         lutil_verbosity_possible_values,
                         "verbosity", &opts.core.verbosity);
@@ -246,6 +531,10 @@ void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
   lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
                         "output-dir", &opts.get.output_dir);
 
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_get,
+                        output_shard_possible_values, "output-shard",
+                        &opts.get.output_shard);
+
   lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
                         "output-name", &opts.get.output_name);
 
@@ -258,9 +547,70 @@ void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
   lopts_keyfile_get_bool(kf, fpath, g_get,
                          "skip-transfer", &opts.get.skip_transfer);
 
+  lopts_keyfile_get_bool(kf, fpath, g_get,
+                         "resume-sidecar", &opts.get.resume_sidecar);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_get,
+                        checksum_possible_values, "checksum",
+                        &opts.get.checksum);
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
+                        "checksum-manifest", &opts.get.checksum_manifest);
+
+  lopts_keyfile_get_int(kf, cb_chk_write_buffer, fpath, g_get,
+                        "write-buffer", &opts.get.write_buffer);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_get,
+                        page_cache_possible_values, "page-cache",
+                        &opts.get.page_cache);
+
+  lopts_keyfile_get_bool(kf, fpath, g_get,
+                         "check-space", &opts.get.check_space);
+
+  lopts_keyfile_get_int(kf, cb_chk_space_margin, fpath, g_get,
+                        "space-margin", &opts.get.space_margin);
+
+  lopts_keyfile_get_bool(kf, fpath, g_get,
+                         "preallocate", &opts.get.preallocate);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_get,
+                        schedule_possible_values, "schedule",
+                        &opts.get.schedule);
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
+                        "index-file", &opts.get.index_file);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_get,
+                        index_action_possible_values, "index-action",
+                        &opts.get.index_action);
+
   lopts_keyfile_get_int(kf, cb_chk_throttle, fpath, g_get,
                         "throttle", &opts.get.throttle);
 
+  lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
+                        "throttle-schedule", &opts.get.throttle_schedule);
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_get, NULL,
+                        "throttle-file", &opts.get.throttle_file);
+
+  lopts_keyfile_get_int(kf, cb_chk_playlist_prefetch, fpath, g_get,
+                        "playlist-prefetch", &opts.get.playlist_prefetch);
+
+  lopts_keyfile_get_int(kf, cb_chk_retry, fpath, g_get,
+                        "retry", &opts.get.retry);
+
+  lopts_keyfile_get_int(kf, cb_chk_retry_delay, fpath, g_get,
+                        "retry-delay", &opts.get.retry_delay);
+
+  lopts_keyfile_get_int(kf, cb_chk_retry_delay, fpath, g_get,
+                        "retry-max-delay", &opts.get.retry_max_delay);
+
+  lopts_keyfile_get_int(kf, cb_chk_throttle, fpath, g_get,
+                        "stall-speed", &opts.get.stall_speed);
+
+  lopts_keyfile_get_int(kf, cb_chk_retry_delay, fpath, g_get,
+                        "stall-time", &opts.get.stall_time);
+
   /* http */
 
   lopts_keyfile_get_bool(kf, fpath, g_http,
@@ -268,6 +618,35 @@ void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
 
   lopts_keyfile_get_str(kf, NULL, fpath, g_http, NULL,
                         "user-agent", &opts.http.user_agent);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_http,
+                        lutil_http_version_possible_values,
+                        "http-version", &opts.http.http_version);
+
+  /* scan */
+
+  lopts_keyfile_get_int(kf, cb_chk_scan_jobs, fpath, g_scan,
+                        "jobs", &opts.scan.jobs);
+
+  lopts_keyfile_get_int(kf, cb_chk_crawl_depth, fpath, g_scan,
+                        "crawl-depth", &opts.scan.crawl_depth);
+
+  lopts_keyfile_get_int(kf, cb_chk_crawl_host_budget, fpath, g_scan,
+                        "crawl-host-budget", &opts.scan.crawl_host_budget);
+
+  lopts_keyfile_get_str(kf, cb_chk_str, fpath, g_scan,
+                        then_possible_values, "then", &opts.scan.then);
+
+  /* serve */
+
+  lopts_keyfile_get_str(kf, NULL, fpath, g_serve, NULL,
+                        "socket", &opts.serve.socket);
+
+  lopts_keyfile_get_int(kf, cb_chk_serve_handles, fpath, g_serve,
+                        "handles", &opts.serve.handles);
+
+  lopts_keyfile_get_int(kf, cb_chk_serve_port, fpath, g_serve,
+                        "port", &opts.serve.port);
 }
 
 #define _chk_r\
@@ -276,6 +655,15 @@ void cb_parse_keyfile_values(GKeyFile *kf, const gchar *fpath)
       return (r);\
   } while (0)
 
+/* An integer option left at OPTS_UNSET gets its default later. */
+static gint cb_chk_int_set(const lopts_cb_chk_ok_int f,
+                           const gchar *opt_name, const gint opt_val)
+{
+  return ((opt_val == OPTS_UNSET)
+          ? EXIT_SUCCESS
+          : f(NULL, opt_name, opt_val));
+}
+
 gint cb_cmdline_validate_values()
 {
   gint r;
@@ -290,6 +678,10 @@ gint cb_cmdline_validate_values()
                  lutil_verbosity_possible_values);
   _chk_r;
 
+  r = cb_chk_int_set(cb_chk_metrics_interval, "metrics-interval",
+                     opts.core.metrics_interval);
+  _chk_r;
+
   r = cb_chk_re(NULL, "output-regex", (const gchar**) opts.get.output_regex);
   _chk_r;
 
@@ -298,11 +690,102 @@ gint cb_cmdline_validate_values()
   r = cb_chk_throttle(NULL, "throttle", opts.get.throttle);
   _chk_r;
 
+  r = cb_chk_playlist_prefetch(NULL, "playlist-prefetch",
+                               opts.get.playlist_prefetch);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "checksum", opts.get.checksum,
+                 checksum_possible_values);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "output-shard", opts.get.output_shard,
+                 output_shard_possible_values);
+  _chk_r;
+
+  r = cb_chk_write_buffer(NULL, "write-buffer", opts.get.write_buffer);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "page-cache", opts.get.page_cache,
+                 page_cache_possible_values);
+  _chk_r;
+
+  r = cb_chk_int_set(cb_chk_space_margin, "space-margin",
+                     opts.get.space_margin);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "schedule", opts.get.schedule,
+                 schedule_possible_values);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "index-action", opts.get.index_action,
+                 index_action_possible_values);
+  _chk_r;
+
+  r = cb_chk_retry(NULL, "retry", opts.get.retry);
+  _chk_r;
+
+  r = cb_chk_int_set(cb_chk_retry_delay, "retry-delay",
+                     opts.get.retry_delay);
+  _chk_r;
+
+  r = cb_chk_int_set(cb_chk_retry_delay, "retry-max-delay",
+                     opts.get.retry_max_delay);
+  _chk_r;
+
+  r = cb_chk_throttle(NULL, "stall-speed", opts.get.stall_speed);
+  _chk_r;
+
+  r = cb_chk_int_set(cb_chk_retry_delay, "stall-time",
+                     opts.get.stall_time);
+  _chk_r;
+
+  /* http */
+
+  r = cb_chk_str(NULL, "http-version", opts.http.http_version,
+                 lutil_http_version_possible_values);
+  _chk_r;
+
+  /* scan */
+
+  r = cb_chk_scan_jobs(NULL, "scan-jobs", opts.scan.jobs);
+  _chk_r;
+
+  r = cb_chk_crawl_depth(NULL, "crawl-depth", opts.scan.crawl_depth);
+  _chk_r;
+
+  r = cb_chk_crawl_host_budget(NULL, "crawl-host-budget",
+                               opts.scan.crawl_host_budget);
+  _chk_r;
+
+  r = cb_chk_str(NULL, "then", opts.scan.then, then_possible_values);
+  _chk_r;
+
+  /* serve */
+
+  r = cb_chk_serve_handles(NULL, "serve-handles", opts.serve.handles);
+  _chk_r;
+
+  r = cb_chk_serve_port(NULL, "serve-port", opts.serve.port);
+  _chk_r;
+
   return (EXIT_SUCCESS);
 }
 
 #undef _chk_r
 
+/*
+ * Mark the integer options for which 0 is a valid value, but not the
+ * default, so that cb_set_post_parse_defaults can tell them apart.
+ */
+void cb_set_pre_parse_defaults()
+{
+  opts.core.metrics_interval = OPTS_UNSET;
+  opts.get.space_margin = OPTS_UNSET;
+  opts.get.retry_max_delay = OPTS_UNSET;
+  opts.get.retry_delay = OPTS_UNSET;
+  opts.get.stall_time = OPTS_UNSET;
+}
+
 void cb_set_post_parse_defaults()
 {
   /* core */
@@ -313,6 +796,9 @@ void cb_set_post_parse_defaults()
   if (opts.core.verbosity == NULL)
     opts.core.verbosity = g_strdup("verbose");
 
+  if (opts.core.metrics_interval == OPTS_UNSET)
+    opts.core.metrics_interval = 15;
+
   /* get */
 
   if (opts.get.output_regex == NULL)
@@ -331,10 +817,55 @@ void cb_set_post_parse_defaults()
   if (opts.get.output_name == NULL)
     opts.get.output_name = g_strdup("%t.%e");
 
+  if (opts.get.output_shard == NULL)
+    opts.get.output_shard = g_strdup("none");
+
+  /* --checksum-manifest implies --checksum sha256. */
+  if (opts.get.checksum == NULL)
+    {
+      opts.get.checksum = g_strdup((opts.get.checksum_manifest != NULL)
+                                   ? "sha256"
+                                   : "none");
+    }
+
+  if (opts.get.page_cache == NULL)
+    opts.get.page_cache = g_strdup("keep");
+
+  if (opts.get.schedule == NULL)
+    opts.get.schedule = g_strdup("input");
+
+  if (opts.get.space_margin == OPTS_UNSET)
+    opts.get.space_margin = 64;
+
+  if (opts.get.index_action == NULL)
+    opts.get.index_action = g_strdup("skip");
+
+  if (opts.get.retry_delay == OPTS_UNSET)
+    opts.get.retry_delay = 1;
+
+  if (opts.get.retry_max_delay == OPTS_UNSET)
+    opts.get.retry_max_delay = 60;
+
+  if (opts.get.stall_time == OPTS_UNSET)
+    opts.get.stall_time = 30;
+
   /* http */
 
   if (opts.http.user_agent == NULL)
     opts.http.user_agent = g_strdup("Mozilla/5.0");
+
+  if (opts.http.http_version == NULL)
+    opts.http.http_version = g_strdup("auto");
+
+  /* scan */
+
+  if (opts.scan.jobs ==0)
+    opts.scan.jobs = 4;
+
+  /* serve */
+
+  if (opts.serve.handles ==0)
+    opts.serve.handles = 4;
 }
 
 gchar *cb_get_config_fpath()
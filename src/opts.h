@@ -30,7 +30,12 @@ struct opts_s
     gchar *subtitle_language;
     gboolean print_subtitles;
     gboolean print_streams;
+    gint metrics_interval;
+    gchar *metrics_file;
     gchar *print_format;
+    gchar *stream_policy;
+    gchar *stats_file;
+    gchar *trace_file;
     gchar *verbosity;
     gchar *stream;
   } core;
@@ -47,20 +52,54 @@ struct opts_s
   } exec;
   struct
   {
+    gchar *checksum_manifest;
+    gboolean resume_sidecar;
+    gboolean check_space;
+    gboolean preallocate;
     gboolean skip_transfer;
+    gchar *checksum;
+    gchar *index_action;
+    gchar *index_file;
     gchar **output_regex;
     gdouble resume_from;
+    gchar *page_cache;
+    gchar *schedule;
+    gchar *output_shard;
     gchar *output_name;
     gchar *output_file;
     gboolean overwrite;
+    gint playlist_prefetch;
+    gint write_buffer;
+    gint space_margin;
+    gint retry_max_delay;
+    gint stall_speed;
+    gint stall_time;
+    gint retry_delay;
+    gint retry;
+    gchar *throttle_schedule;
+    gchar *throttle_file;
     gchar *output_dir;
     gint throttle;
   } get;
   struct
   {
     gboolean enable_cookies;
+    gchar *http_version;
     gchar *user_agent;
   } http;
+  struct
+  {
+    gint crawl_host_budget;
+    gint crawl_depth;
+    gchar *then;
+    gint jobs;
+  } scan;
+  struct
+  {
+    gchar *socket;
+    gint handles;
+    gint port;
+  } serve;
   gchar **rargs;
 };
 
@@ -69,11 +108,14 @@ typedef struct opts_s *opts_t;
 extern const GOptionEntry option_entries[];
 extern struct opts_s opts;
 
+#define OPTS_UNSET -1 /* see cb_set_pre_parse_defaults */
+
 /* callbacks */
 
 void cb_parse_keyfile_values(GKeyFile*, const gchar*);
 gint cb_cmdline_validate_values();
 void cb_set_post_parse_defaults();
+void cb_set_pre_parse_defaults();
 gchar *cb_get_config_fpath();
 
 #endif /* opts_h */
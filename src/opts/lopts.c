@@ -64,6 +64,9 @@ gint lopts_new(lopts_t lopts)
 
   show_config = FALSE;
 
+  if (lopts->cb.set_pre_parse_defaults != NULL)
+    lopts->cb.set_pre_parse_defaults();
+
   /* read config files. */
 
   keyfile_read(lopts);
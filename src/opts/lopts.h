@@ -28,6 +28,7 @@ typedef gchar *(*lopts_cb_get_config_fpath)();
 
 typedef gint (*lopts_cb_cmdline_validate_values)();
 typedef void (*lopts_cb_set_post_parse_defaults)();
+typedef void (*lopts_cb_set_pre_parse_defaults)();
 
 typedef gint (*lopts_cb_chk_ok_strv)(const gchar*,
                                      const gchar*,
@@ -58,6 +59,7 @@ struct lopts_s
   {
     lopts_cb_cmdline_validate_values  cmdline_validate_values;
     lopts_cb_set_post_parse_defaults  set_post_parse_defaults;
+    lopts_cb_set_pre_parse_defaults   set_pre_parse_defaults;
     lopts_cb_parse_keyfile_values     parse_keyfile_values;
     lopts_cb_get_config_fpath         get_config_fpath;
   } cb;
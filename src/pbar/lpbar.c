@@ -60,6 +60,18 @@ static const gchar *_to_unit(gdouble *n)
   return (_units[i]);
 }
 
+static void _print_timing(const lpbar_t p)
+{
+  if (p->timing.set == FALSE)
+    return;
+
+  g_print(_("  timing: dns %.3fs  connect %.3fs  tls %.3fs  "
+            "ttfb %.3fs  total %.3fs  redirects %ld  http/%s\n"),
+          p->timing.namelookup, p->timing.connect, p->timing.appconnect,
+          p->timing.starttransfer, p->timing.total, p->timing.redirects,
+          p->timing.http_version);
+}
+
 lpbar_t lpbar_new()
 {
   lpbar_t p = g_new0(struct lpbar_s, 1);
@@ -83,6 +95,7 @@ void lpbar_free(lpbar_t p)
     {
       p->flags.done = TRUE;
       lpbar_update(p, -1);
+      _print_timing(p);
     }
 
   g_timer_destroy(p->counters.timer);
@@ -196,7 +209,13 @@ void lpbar_print(const lpbar_t p)
   b = p->content_bytes;
   u = _to_unit(&b);
 
-  g_print(_("file: %s  [media]\n"), p->fname);
+  if (p->queue.pos >0)
+    {
+      g_print(_("file: %s  [media %u/%u]\n"), p->fname, p->queue.pos,
+              p->queue.len);
+    }
+  else
+    g_print(_("file: %s  [media]\n"), p->fname);
   g_print(_("  content length: %.1f%s"), b, u);
 
   if (p->content_type != NULL)
@@ -31,6 +31,11 @@ struct lpbar_s
   lpbar_mode mode;
   gchar *fname;
   struct
+  {
+    guint pos; /* 1-based, 0 if not scheduled */
+    guint len;
+  } queue; /* --schedule */
+  struct
   {
     gdouble last_update;
     gint curr_frame;
@@ -38,6 +43,17 @@ struct lpbar_s
     GTimer *timer;
   } counters;
   struct
+  {
+    gdouble starttransfer;
+    gdouble appconnect;
+    gdouble namelookup;
+    gdouble connect;
+    gdouble total;
+    const gchar *http_version;
+    glong redirects;
+    gboolean set;
+  } timing; /* seconds since the start of the request */
+  struct
   {
     gboolean failed;
     gboolean done;
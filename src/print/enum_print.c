@@ -293,6 +293,7 @@ gint lprint_enum_playlist_properties(quvi_playlist_t qp, gpointer data)
       _print_pp_d(QUVI_PLAYLIST_MEDIA_PROPERTY_DURATION_MS);
       _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_TITLE);
       _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_URL);
+      fflush(stdout);
     }
   return (EXIT_SUCCESS);
 }
@@ -318,6 +319,11 @@ gint lprint_enum_scan_print_buffer(gpointer data)
   return (EXIT_SUCCESS);
 }
 
+void lprint_enum_scan_media_url(const gchar *s)
+{
+  g_print("quvi_scan_next_media_url=%s\n", s);
+}
+
 gint lprint_enum_scan_properties(quvi_scan_t qs, gpointer data)
 {
   const gchar *s;
@@ -330,7 +336,7 @@ gint lprint_enum_scan_properties(quvi_scan_t qs, gpointer data)
    */
 
   while ( (s = quvi_scan_next_media_url(qs)) != NULL)
-    g_print("quvi_scan_next_media_url=%s\n", s);
+    lprint_enum_scan_media_url(s);
 
   return (EXIT_SUCCESS);
 }
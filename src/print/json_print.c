@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <json-glib/json-glib.h>
 #include <glib/gprintf.h>
 #include <quvi.h>
@@ -103,6 +104,26 @@ static gint _print_buffer(const json_t p)
   return (EXIT_SUCCESS);
 }
 
+/* Return the data for the builder root node, reset the builder. */
+static gchar *_builder_to_data(const json_t p)
+{
+  JsonGenerator *g;
+  JsonNode *r;
+  gchar *s;
+
+  g = json_generator_new();
+  r = json_builder_get_root(p->b);
+
+  json_generator_set_root(g, r);
+  s = json_generator_to_data(g, NULL);
+
+  json_node_free(r);
+  g_object_unref(g);
+
+  json_builder_reset(p->b);
+  return (s);
+}
+
 extern const gchar *reserved_chars;
 
 void lprint_json_errmsg(const gchar *fmt, ...)
@@ -340,7 +361,9 @@ void lprint_json_playlist_free(gpointer data)
 
 gint lprint_json_playlist_print_buffer(gpointer data)
 {
-  return (_print_buffer(data));
+  /* Close the document opened by lprint_json_playlist_properties. */
+  g_print("\n]}}}\n");
+  return (EXIT_SUCCESS);
 }
 
 static gint _pp_s(const json_t p, const quvi_playlist_t qp,
@@ -371,44 +394,74 @@ static gint _pp_d(const json_t p, const quvi_playlist_t qp,
       return (EXIT_FAILURE);\
   } while (0)
 
+/* Print a media entry of the playlist on a line of its own. */
+static gint _print_playlist_media(const json_t p,
+                                  const quvi_playlist_t qp,
+                                  const gint n)
+{
+  gchar *s;
+
+  json_builder_begin_object(p->b); /* media */
+  _print_pp_d(QUVI_PLAYLIST_MEDIA_PROPERTY_DURATION_MS);
+  _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_TITLE);
+  _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_URL);
+  json_builder_end_object(p->b); /* media */
+
+  s = _builder_to_data(p);
+  g_print("%s%s", (n >0) ? ",\n":"", s);
+  fflush(stdout);
+  g_free(s);
+
+  return (EXIT_SUCCESS);
+}
+
+/*
+ * The playlist is printed as it is being parsed: the document opens
+ * with the playlist properties, each media entry is printed on a line
+ * of its own as soon as libquvi returns it, and
+ * lprint_json_playlist_print_buffer closes the document.
+ */
 gint lprint_json_playlist_properties(quvi_playlist_t qp, gpointer data)
 {
   json_t p = (json_t) data;
+  gchar *s, *e;
+  gint n, r;
 
   g_assert(data != NULL);
   g_assert(qp != NULL);
 
-  json_builder_begin_object(p->b); /* root */
-
-  json_builder_set_member_name(p->b, "quvi");
-  json_builder_begin_object(p->b);
-
-  json_builder_set_member_name(p->b, "playlist");
-  json_builder_begin_object(p->b);
+  json_builder_begin_object(p->b); /* playlist */
 
   _print_pp_s(QUVI_PLAYLIST_PROPERTY_THUMBNAIL_URL);
   _print_pp_s(QUVI_PLAYLIST_PROPERTY_TITLE);
   _print_pp_s(QUVI_PLAYLIST_PROPERTY_ID);
 
-  json_builder_set_member_name(p->b, "media");
-  json_builder_begin_array(p->b);
+  json_builder_end_object(p->b); /* playlist */
 
-  while (quvi_playlist_media_next(qp) == QUVI_TRUE)
-    {
-      json_builder_begin_object(p->b); /* media */
-      _print_pp_d(QUVI_PLAYLIST_MEDIA_PROPERTY_DURATION_MS);
-      _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_TITLE);
-      _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_URL);
-      json_builder_end_object(p->b); /* media */
-    }
+  /* Leave the playlist object open for the "media" array. */
 
-  json_builder_end_array(p->b); /* media */
-  json_builder_end_object(p->b); /* playlist */
+  s = _builder_to_data(p);
+  e = strrchr(s, '}');
 
-  json_builder_end_object(p->b); /* quvi */
-  json_builder_end_object(p->b); /* root */
+  if (e != NULL)
+    *e = '\0';
 
-  return (EXIT_SUCCESS);
+  g_print("{\"quvi\":{\"playlist\":%s%s\"media\":[\n",
+          s, (strlen(s) >1) ? ",":"");
+  fflush(stdout);
+  g_free(s);
+
+  r = EXIT_SUCCESS;
+  n = 0;
+
+  while (r == EXIT_SUCCESS && quvi_playlist_media_next(qp) == QUVI_TRUE)
+    r = _print_playlist_media(p, qp, n++);
+
+  /* The caller skips print_buffer on error, close the document here. */
+  if (r != EXIT_SUCCESS)
+    lprint_json_playlist_print_buffer(p);
+
+  return (r);
 }
 
 #undef _print_pp_s
@@ -85,6 +85,7 @@ gint lprint_enum_media_streams_available(quvi_t, quvi_media_t);
 
   /* scan */
 gint lprint_enum_scan_properties(quvi_scan_t, gpointer);
+void lprint_enum_scan_media_url(const gchar*);
 gint lprint_enum_scan_print_buffer(gpointer);
 
 gint lprint_enum_scan_new(quvi_t, gpointer*);
@@ -194,6 +195,7 @@ gint lprint_rfc2483_media_streams_available(quvi_t, quvi_media_t);
 
   /* scan */
 gint lprint_rfc2483_scan_properties(quvi_scan_t, gpointer);
+void lprint_rfc2483_scan_media_url(const gchar*);
 gint lprint_rfc2483_scan_print_buffer(gpointer);
 
 gint lprint_rfc2483_scan_new(quvi_t, gpointer*);
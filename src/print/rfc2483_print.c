@@ -242,6 +242,7 @@ gint lprint_rfc2483_playlist_properties(quvi_playlist_t qp, gpointer data)
       _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_TITLE, TRUE, FALSE);
       _print_pp_d(QUVI_PLAYLIST_MEDIA_PROPERTY_DURATION_MS, TRUE);
       _print_pp_s(QUVI_PLAYLIST_MEDIA_PROPERTY_URL, FALSE, TRUE);
+      fflush(stdout);
     }
   return (EXIT_SUCCESS);
 }
@@ -266,6 +267,13 @@ gint lprint_rfc2483_scan_print_buffer(gpointer data)
   return (EXIT_SUCCESS);
 }
 
+void lprint_rfc2483_scan_media_url(const gchar *s)
+{
+  gchar *e = g_uri_escape_string(s, reserved_chars, FALSE);
+  g_print("%s\n", e);
+  g_free(e);
+}
+
 gint lprint_rfc2483_scan_properties(quvi_scan_t qs, gpointer data)
 {
   const gchar *s;
@@ -276,11 +284,8 @@ gint lprint_rfc2483_scan_properties(quvi_scan_t qs, gpointer data)
 
   g_print(_("# Embedded media URLs\n#\n"));
   while ( (s = quvi_scan_next_media_url(qs)) != NULL)
-    {
-      gchar *e = g_uri_escape_string(s, reserved_chars, FALSE);
-      g_print("%s\n", e);
-      g_free(e);
-    }
+    lprint_rfc2483_scan_media_url(s);
+
   return (EXIT_SUCCESS);
 }
 
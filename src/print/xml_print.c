@@ -33,6 +33,7 @@
 struct xml_s
 {
   xmlTextWriterPtr w;
+  xmlBufferPtr buf; /* streamed documents only */
   quvi_media_t qm;
   xmlDocPtr d;
   quvi_t q;
@@ -87,6 +88,40 @@ static gint _xml_handle_new(quvi_t q, quvi_media_t qm, gpointer *dst)
   return (EXIT_SUCCESS);
 }
 
+/* Same as above, but write the document to a buffer to be streamed. */
+static gint _xml_stream_handle_new(quvi_t q, gpointer *dst)
+{
+  xml_t p;
+
+  g_assert(dst != NULL);
+
+  p = g_new0(struct xml_s, 1);
+  p->q = q;
+
+  p->buf = xmlBufferCreate();
+  p->w = xmlNewTextWriterMemory(p->buf, 0);
+
+  if (p->w == NULL)
+    {
+      lprint_xml_errmsg(_("while creating the XML writer"));
+      xmlBufferFree(p->buf);
+      g_free(p);
+      return (EXIT_FAILURE);
+    }
+
+  if (xmlTextWriterStartDocument(p->w, NULL, "UTF-8", NULL) <0)
+    {
+      lprint_xml_errmsg(_("while starting the XML document"));
+      xmlFreeTextWriter(p->w);
+      xmlBufferFree(p->buf);
+      g_free(p);
+      return (EXIT_FAILURE);
+    }
+  *dst = p;
+
+  return (EXIT_SUCCESS);
+}
+
 static gint _xml_handle_free(gpointer data, const gint r)
 {
   xml_t p = (xml_t) data;
@@ -103,6 +138,9 @@ static gint _xml_handle_free(gpointer data, const gint r)
   if (p->d != NULL)
     xmlFreeDoc(p->d);
 
+  if (p->buf != NULL)
+    xmlBufferFree(p->buf);
+
   g_free(p);
   return (r);
 }
@@ -203,6 +241,20 @@ static gint _print_buffer(xml_t p)
   return (EXIT_SUCCESS);
 }
 
+/* Print what has been written to the streamed document so far. */
+static void _print_stream(xml_t p)
+{
+  g_assert(p->buf != NULL);
+
+  xmlTextWriterFlush(p->w);
+  if (xmlBufferLength(p->buf) >0)
+    {
+      g_print("%s", (const gchar*) xmlBufferContent(p->buf));
+      xmlBufferEmpty(p->buf);
+      fflush(stdout);
+    }
+}
+
 void lprint_xml_errmsg(const gchar *fmt, ...)
 {
   va_list args;
@@ -403,7 +455,7 @@ gint lprint_xml_media_properties(gpointer data)
 
 gint lprint_xml_playlist_new(quvi_t q, gpointer *dst)
 {
-  return (_xml_handle_new(q, NULL, dst));
+  return (_xml_stream_handle_new(q, dst));
 }
 
 void lprint_xml_playlist_free(gpointer dst)
@@ -413,37 +465,59 @@ void lprint_xml_playlist_free(gpointer dst)
 
 gint lprint_xml_playlist_print_buffer(gpointer data)
 {
-  return (_print_buffer(data));
+  xml_t p = (xml_t) data;
+
+  g_assert(p != NULL);
+
+  /* Print the rest of the document streamed by playlist_properties. */
+
+  if (xmlTextWriterEndDocument(p->w) <0)
+    {
+      lprint_xml_errmsg(_("while ending the XML document"));
+      return (EXIT_FAILURE);
+    }
+  _print_stream(p);
+
+  return (EXIT_SUCCESS);
 }
 
+/* The caller skips print_buffer on error, close the document here. */
+#define _chk_pp(c)\
+  do {\
+    if ((c) != EXIT_SUCCESS)\
+      {\
+        lprint_xml_playlist_print_buffer(p);\
+        return (EXIT_FAILURE);\
+      }\
+  } while (0)
+
 static gint _pp_attr_s(const xml_t p, const quvi_playlist_t qp,
                        const QuviPlaylistProperty qpp, const gchar *n)
 {
   gchar *s = NULL;
   quvi_playlist_get(qp, qpp, &s);
-  _chk_r_e(_attr_new(p, UTIL_PROPERTY_TYPE_PLAYLIST, n, s, -1));
+  return (_attr_new(p, UTIL_PROPERTY_TYPE_PLAYLIST, n, s, -1));
 }
 
 #define _print_pp_attr_s(n)\
-  do {\
-    if (_pp_attr_s(p, qp, n, #n) != EXIT_SUCCESS)\
-      return (EXIT_FAILURE);\
-  } while (0)
+  _chk_pp(_pp_attr_s(p, qp, n, #n))
 
 static gint _pp_attr_d(const xml_t p, const quvi_playlist_t qp,
                        const QuviPlaylistProperty qpp, const gchar *n)
 {
   gdouble d = 0;
   quvi_playlist_get(qp, qpp, &d);
-  _chk_r_e(_attr_new(p, UTIL_PROPERTY_TYPE_PLAYLIST, n, NULL, d));
+  return (_attr_new(p, UTIL_PROPERTY_TYPE_PLAYLIST, n, NULL, d));
 }
 
 #define _print_pp_attr_d(n)\
-  do {\
-    if (_pp_attr_d(p, qp, n, #n) != EXIT_SUCCESS)\
-      return (EXIT_FAILURE);\
-  } while (0)
+  _chk_pp(_pp_attr_d(p, qp, n, #n))
 
+/*
+ * The playlist is printed as it is being parsed: each media element is
+ * printed as soon as libquvi returns it, and
+ * lprint_xml_playlist_print_buffer prints the end of the document.
+ */
 gint lprint_xml_playlist_properties(quvi_playlist_t qp, gpointer data)
 {
   xml_t p = (xml_t) data;
@@ -451,10 +525,10 @@ gint lprint_xml_playlist_properties(quvi_playlist_t qp, gpointer data)
   g_assert(data != NULL);
   g_assert(qp != NULL);
   g_assert(p->w != NULL);
-  g_assert(p->d != NULL);
+  g_assert(p->buf != NULL);
 
-  _chk_r(_start_e(p, START_R, "quvi"));
-  _chk_r(_start_e(p, START_E, "playlist"));
+  _chk_pp(_start_e(p, START_R, "quvi"));
+  _chk_pp(_start_e(p, START_E, "playlist"));
 
   _print_pp_attr_s(QUVI_PLAYLIST_PROPERTY_THUMBNAIL_URL);
   _print_pp_attr_s(QUVI_PLAYLIST_PROPERTY_TITLE);
@@ -462,19 +536,23 @@ gint lprint_xml_playlist_properties(quvi_playlist_t qp, gpointer data)
 
   while (quvi_playlist_media_next(qp) == QUVI_TRUE)
     {
-      _chk_r(_start_e(p, START_E, "media"));
+      _chk_pp(_start_e(p, START_E, "media"));
       _print_pp_attr_d(QUVI_PLAYLIST_MEDIA_PROPERTY_DURATION_MS);
       _print_pp_attr_s(QUVI_PLAYLIST_MEDIA_PROPERTY_TITLE);
       _print_pp_attr_s(QUVI_PLAYLIST_MEDIA_PROPERTY_URL);
-      _chk_r(_end_e(p, END_E, "media"));
+      _chk_pp(_end_e(p, END_E, "media"));
+      _print_stream(p);
     }
 
-  _chk_r(_end_e(p, END_E, "playlist"));
-  _chk_r_e(_end_e(p, END_R, "quvi"));
+  _chk_pp(_end_e(p, END_E, "playlist"));
+  _chk_pp(_end_e(p, END_R, "quvi"));
+
+  return (EXIT_SUCCESS);
 }
 
-#undef _print_pp_s
-#undef _print_pp_d
+#undef _print_pp_attr_s
+#undef _print_pp_attr_d
+#undef _chk_pp
 
 /* scan */
 
@@ -26,11 +26,13 @@
 #include <quvi.h>
 
 #include "linput.h"
+#include "lprint.h"
 #include "lutil.h"
 #include "lopts.h"
 #include "setup.h"
 #include "opts.h"
 
+extern QuviError cb_status_quiet(glong, gpointer, gpointer);
 extern QuviError cb_status(glong, gpointer, gpointer);
 extern struct opts_s opts;
 
@@ -39,6 +41,7 @@ gint setup_opts(gint argc, gchar **argv, lopts_t lopts)
   memset(lopts, 0, sizeof(struct lopts_s));
 
   lopts->cb.set_post_parse_defaults = cb_set_post_parse_defaults;
+  lopts->cb.set_pre_parse_defaults = cb_set_pre_parse_defaults;
   lopts->cb.cmdline_validate_values = cb_cmdline_validate_values;
   lopts->cb.parse_keyfile_values = cb_parse_keyfile_values;
   lopts->cb.get_config_fpath = cb_get_config_fpath;
@@ -53,6 +56,37 @@ gint setup_opts(gint argc, gchar **argv, lopts_t lopts)
   if (g_strcmp0(opts.core.verbosity, "debug") ==0)
     lopts_print_config_values(lopts);
 
+  if (opts.core.trace_file != NULL)
+    {
+      if (lutil_trace_init(opts.core.trace_file,
+                           lprint_enum_errmsg) != EXIT_SUCCESS)
+        {
+          return (EXIT_FAILURE);
+        }
+    }
+
+  if (lutil_ratelimit_init(opts.get.throttle, opts.get.throttle_schedule,
+                           opts.get.throttle_file,
+                           lprint_enum_errmsg) != EXIT_SUCCESS)
+    {
+      return (EXIT_FAILURE);
+    }
+
+  if (opts.get.index_file != NULL)
+    {
+      if (lutil_index_init(opts.get.index_file,
+                           lprint_enum_errmsg) != EXIT_SUCCESS)
+        {
+          return (EXIT_FAILURE);
+        }
+    }
+
+  if (opts.core.metrics_file != NULL)
+    {
+      return (lutil_metrics_init(opts.core.metrics_file,
+                                 opts.core.metrics_interval,
+                                 lprint_enum_errmsg));
+    }
   return (EXIT_SUCCESS);
 }
 
@@ -67,6 +101,7 @@ gint setup_quvi(quvi_t *q)
 
   o.verbose = (v == UTIL_VERBOSITY_LEVEL_DEBUG) ? 1:0;
   o.throttle_ki_s = opts.get.throttle;
+  o.http_version = opts.http.http_version;
 
   r = lutil_quvi_init(q, &o);
   if (r == EXIT_SUCCESS)
@@ -78,6 +113,20 @@ gint setup_quvi(quvi_t *q)
   return (r);
 }
 
+/*
+ * Initialize a handle for a lutil_quvi_pool_t. The handles in a pool
+ * are used from the worker threads: the status updates are meant for
+ * the terminal, leave them to the main thread (the trace only).
+ */
+gint setup_quvi_pool_handle(gpointer *q)
+{
+  if (setup_quvi((quvi_t*) q) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  quvi_set(*q, QUVI_OPTION_CALLBACK_STATUS, cb_status_quiet);
+  return (EXIT_SUCCESS);
+}
+
 #define _reverse(p)\
   do {\
     if (p != NULL)\
@@ -138,6 +187,7 @@ gint setup_query(setup_query_t sq)
   memset(&qps, 0, sizeof(struct lutil_query_properties_s));
 
   qps.activity = sq->activity.playlist;
+  qps.stream_policy = sq->stream_policy;
   qps.exit_status = EXIT_SUCCESS;
   qps.xperr = sq->xperr;
   qps.perr = sq->perr;
@@ -25,6 +25,7 @@ struct setup_query_s
 {
   gboolean force_subtitle_mode;
   lutil_cb_printerr xperr;
+  lutil_policy_t stream_policy;
   lutil_cb_printerr perr;
   linput_t linput;
   quvi_t q;
@@ -40,6 +41,7 @@ typedef struct setup_query_s *setup_query_t;
 
 gint setup_opts(gint, gchar**, lopts_t);
 gint setup_query(setup_query_t);
+gint setup_quvi_pool_handle(gpointer*);
 gint setup_quvi(quvi_t*);
 
 #endif /* setup_h */
@@ -26,6 +26,8 @@
 #include "sig.h"
 
 static volatile sig_atomic_t recv_sigwinch = 0;
+static volatile sig_atomic_t recv_sigterm = 0;
+static volatile sig_atomic_t defer_sigterm = 0;
 static gsize max_width = 0;
 
 static void _sigwinch(int signo)
@@ -71,4 +73,67 @@ gsize sigwinch_term_spaceleft(const gsize len)
   return (max_width - len -1);
 }
 
+/*
+ * Terminate at once, unless a transfer is under way: it is then
+ * aborted through its progress callback, see sigterm_defer.
+ */
+static void _sigterm(int signo)
+{
+  if (defer_sigterm ==0)
+    {
+      signal(signo, SIG_DFL);
+      raise(signo);
+    }
+  else
+    recv_sigterm = signo;
+}
+
+void sigterm_setup(struct sigaction *san, struct sigaction *sai,
+                   struct sigaction *sat)
+{
+  san->sa_handler = _sigterm;
+  sigemptyset(&san->sa_mask);
+  san->sa_flags = 0;
+
+  sigaction(SIGINT, NULL, sai);
+  sigaction(SIGTERM, NULL, sat);
+
+  if (sai->sa_handler == SIG_DFL)
+    sigaction(SIGINT, san, NULL);
+
+  if (sat->sa_handler == SIG_DFL)
+    sigaction(SIGTERM, san, NULL);
+}
+
+void sigterm_reset(const struct sigaction *sai,
+                   const struct sigaction *sat)
+{
+  if (sai->sa_handler == SIG_DFL)
+    sigaction(SIGINT, sai, NULL);
+
+  if (sat->sa_handler == SIG_DFL)
+    sigaction(SIGTERM, sat, NULL);
+}
+
+/*
+ * Defer SIGINT and SIGTERM while the file and its sidecar are being
+ * written. Raise the signal received in the meantime, if any, when
+ * the transfer is over.
+ */
+void sigterm_defer(const gboolean defer)
+{
+  defer_sigterm = (defer == TRUE) ? 1:0;
+
+  if (defer == FALSE && recv_sigterm !=0)
+    {
+      signal(recv_sigterm, SIG_DFL);
+      raise(recv_sigterm);
+    }
+}
+
+gboolean sigterm_received()
+{
+  return ((recv_sigterm !=0) ? TRUE:FALSE);
+}
+
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
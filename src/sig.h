@@ -27,6 +27,12 @@ void sigwinch_setup(struct sigaction*, struct sigaction*);
 void sigwinch_reset(const struct sigaction*);
 gsize sigwinch_term_spaceleft(const gsize);
 
+void sigterm_setup(struct sigaction*, struct sigaction*,
+                   struct sigaction*);
+void sigterm_reset(const struct sigaction*, const struct sigaction*);
+void sigterm_defer(const gboolean);
+gboolean sigterm_received();
+
 #endif /* sig_h */
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -80,6 +80,41 @@ static void _fetch(const quvi_word type, const gpointer data)
     _done();
 }
 
+/* Record the libquvi activity as spans in --trace-file. */
+static void _trace(const quvi_word status, const quvi_word type,
+                   const gpointer data)
+{
+  const gchar *n;
+
+  switch (status)
+    {
+    case QUVI_CALLBACK_STATUS_HTTP_QUERY_METAINFO:
+      n = "metainfo";
+      break;
+    case QUVI_CALLBACK_STATUS_RESOLVE:
+      n = "resolve";
+      break;
+    case QUVI_CALLBACK_STATUS_FETCH:
+      n = "fetch";
+      break;
+    default:
+      return;
+    }
+
+  if (type != QUVI_CALLBACK_STATUS_DONE)
+    lutil_trace_begin("libquvi", n, (const gchar*) data);
+  else
+    lutil_trace_end("libquvi", n);
+}
+
+/* The status callback of the handles used by the worker threads. */
+QuviError cb_status_quiet(glong status_type, gpointer data,
+                          gpointer user_data)
+{
+  _trace(quvi_loword(status_type), quvi_hiword(status_type), data);
+  return (QUVI_OK);
+}
+
 static void _resolve(const quvi_word type)
 {
   if (type != QUVI_CALLBACK_STATUS_DONE)
@@ -103,6 +138,8 @@ QuviError cb_status(glong status_type, gpointer data, gpointer user_data)
   status = quvi_loword(status_type);
   type = quvi_hiword(status_type);
 
+  _trace(status, type, data);
+
   switch (status)
     {
     case QUVI_CALLBACK_STATUS_HTTP_QUERY_METAINFO:
@@ -0,0 +1,202 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Resolve a list of URLs ahead of their consumer. The URLs are
+ * resolved in a thread pool, each with a libquvi handle of its own,
+ * and then consumed in the input order by the calling thread.
+ *
+ * An item keeps its handle until it has been consumed: the object
+ * returned by the resolver belongs to the handle. The handles are
+ * checked out in the input order, and the pool has one handle more
+ * than the lookahead window, so that checking out a handle never
+ * blocks behind an item that has not been consumed yet.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <quvi.h>
+
+#include "lutil.h"
+
+struct _item_s
+{
+  gboolean done;
+  gchar *errmsg;
+  gpointer obj;
+  gchar *url;
+  quvi_t q;
+};
+
+typedef struct _item_s *_item_t;
+
+struct _ahead_s
+{
+  lutil_resolve_ahead_t opts;
+  lutil_quvi_pool_t pool;
+  GThreadPool *tp;
+  GMutex lock;
+  GCond cond;
+};
+
+typedef struct _ahead_s *_ahead_t;
+
+static void _resolve(gpointer data, gpointer userdata)
+{
+  _ahead_t a;
+  _item_t i;
+  gpointer o;
+
+  a = (_ahead_t) userdata;
+  i = (_item_t) data;
+
+  o = a->opts->resolve(i->q, i->url, a->opts->userdata);
+
+  g_mutex_lock(&a->lock);
+  if (quvi_ok(i->q) == QUVI_FALSE)
+    i->errmsg = g_strdup(quvi_errmsg(i->q));
+  i->done = TRUE;
+  i->obj = o;
+  g_cond_broadcast(&a->cond);
+  g_mutex_unlock(&a->lock);
+}
+
+static void _wait(_ahead_t a, _item_t i)
+{
+  g_mutex_lock(&a->lock);
+  while (i->done == FALSE)
+    g_cond_wait(&a->cond, &a->lock);
+  g_mutex_unlock(&a->lock);
+}
+
+/* Wait for the item to be resolved, then release its handle. */
+static void _release(_ahead_t a, _item_t i)
+{
+  _wait(a, i);
+
+  a->opts->free(i->obj);
+  i->obj = NULL;
+
+  lutil_quvi_pool_push(a->pool, i->q);
+  i->q = NULL;
+}
+
+static void _item_free(_item_t i)
+{
+  g_free(i->errmsg);
+  g_free(i->url);
+  g_free(i);
+}
+
+static GPtrArray *_items_new(const GSList *urls)
+{
+  GPtrArray *r;
+
+  r = g_ptr_array_new_with_free_func((GDestroyNotify) _item_free);
+  while (urls != NULL)
+    {
+      _item_t i = g_new0(struct _item_s, 1);
+      i->url = g_strdup((const gchar*) urls->data);
+      g_ptr_array_add(r, i);
+      urls = g_slist_next(urls);
+    }
+  return (r);
+}
+
+gint lutil_resolve_ahead(lutil_resolve_ahead_t o, const GSList *urls)
+{
+  struct _ahead_s a;
+  guint i, next;
+  GPtrArray *v;
+  GError *e;
+  gint r;
+
+  g_assert(o != NULL);
+  g_assert(o->quvi_init != NULL);
+  g_assert(o->consume != NULL);
+  g_assert(o->resolve != NULL);
+  g_assert(o->free != NULL);
+  g_assert(o->xperr != NULL);
+
+  memset(&a, 0, sizeof(struct _ahead_s));
+  a.opts = o;
+
+  a.pool = lutil_quvi_pool_new(o->window+1, o->quvi_init);
+  if (a.pool == NULL)
+    return (EXIT_FAILURE);
+
+  e = NULL;
+  a.tp = g_thread_pool_new(_resolve, &a, o->window+1, FALSE, &e);
+  if (a.tp == NULL)
+    {
+      o->xperr(_("while creating thread pool: %s"), e->message);
+      lutil_quvi_pool_free(a.pool);
+      g_error_free(e);
+      return (EXIT_FAILURE);
+    }
+
+  g_mutex_init(&a.lock);
+  g_cond_init(&a.cond);
+
+  v = _items_new(urls);
+  r = EXIT_SUCCESS;
+  next = 0;
+
+  for (i=0; i<v->len && r == EXIT_SUCCESS; ++i)
+    {
+      _item_t p;
+
+      /* Fill the lookahead window. */
+
+      while (next < v->len && next <= i+o->window)
+        {
+          p = (_item_t) g_ptr_array_index(v, next++);
+          p->q = lutil_quvi_pool_pop(a.pool);
+
+          if (g_thread_pool_push(a.tp, p, NULL) == FALSE)
+            _resolve(p, &a);
+        }
+
+      p = (_item_t) g_ptr_array_index(v, i);
+      _wait(&a, p);
+
+      r = o->consume(p->q, p->obj, p->url, p->errmsg, o->userdata);
+      _release(&a, p);
+    }
+
+  /* Drain the items that were resolved ahead of a failed item. */
+
+  while (i < next)
+    _release(&a, (_item_t) g_ptr_array_index(v, i++));
+
+  g_thread_pool_free(a.tp, FALSE, TRUE);
+  lutil_quvi_pool_free(a.pool);
+  g_ptr_array_free(v, TRUE);
+
+  g_mutex_clear(&a.lock);
+  g_cond_clear(&a.cond);
+
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
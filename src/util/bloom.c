@@ -0,0 +1,117 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A Bloom filter for strings: a fixed amount of memory regardless of
+ * the number of the strings added, at the cost of the occasional false
+ * positive. The k bit positions are derived from two hashes (Kirsch,
+ * Mitzenmacher).
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "lutil.h"
+
+/*
+ * Size the filter for n strings at the false positive rate p: the
+ * optimal k is log2(1/p), rounded up here, and m = n*k/ln(2) bits.
+ */
+lutil_bloom_t lutil_bloom_new(const guint n, const gdouble p)
+{
+  lutil_bloom_t b;
+  gdouble x;
+  guint k;
+
+  g_assert(n >0);
+  g_assert(p >0 && p <1);
+
+  for (k=0, x=1; x>p; x/=2)
+    ++k;
+
+  b = g_new0(struct lutil_bloom_s, 1);
+  b->nbits = MAX((guint64) (n*k/G_LN2), 64);
+  b->k = CLAMP(k, 1, 16);
+  b->bits = g_malloc0((b->nbits+7)/8);
+
+  return (b);
+}
+
+void lutil_bloom_free(lutil_bloom_t b)
+{
+  if (b == NULL)
+    return;
+
+  g_free(b->bits);
+  g_free(b);
+}
+
+/* FNV-1a, 64-bit. */
+static guint64 _fnv1a(const gchar *s)
+{
+  guint64 h = G_GUINT64_CONSTANT(14695981039346656037);
+  while (*s != '\0')
+    {
+      h ^= (guchar) *s++;
+      h *= G_GUINT64_CONSTANT(1099511628211);
+    }
+  return (h);
+}
+
+/* djb2, 64-bit. */
+static guint64 _djb2(const gchar *s)
+{
+  guint64 h = 5381;
+  while (*s != '\0')
+    h = ((h << 5) + h) + (guchar) *s++;
+  return (h | 1); /* Odd, so that the probe sequence never repeats. */
+}
+
+/*
+ * Add the string to the filter. Return TRUE if the string was (most
+ * likely) added before.
+ */
+gboolean lutil_bloom_test_and_add(lutil_bloom_t b, const gchar *s)
+{
+  guint64 h1, h2, i;
+  gboolean r;
+  guint k;
+
+  g_assert(b != NULL);
+  g_assert(s != NULL);
+
+  h1 = _fnv1a(s);
+  h2 = _djb2(s);
+  r = TRUE;
+
+  for (k=0; k<b->k; ++k)
+    {
+      i = (h1 + k*h2) % b->nbits;
+      if ((b->bits[i/8] & (1 << (i%8))) ==0)
+        {
+          b->bits[i/8] |= (1 << (i%8));
+          r = FALSE;
+        }
+    }
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <glib/gi18n.h>
 #include <quvi.h>
 
@@ -72,4 +73,53 @@ gint lutil_choose_subtitle(const quvi_t q, const quvi_subtitle_t qsub,
     }
 }
 
+/*
+ * Choose a subtitle language for each of the ';' separated groups of
+ * patterns in lang, e.g. "^en;^fr,^de". Each group is matched like the
+ * lang of lutil_choose_subtitle. Return the chosen languages in the
+ * group order, each language once.
+ */
+gint lutil_choose_subtitles(const quvi_t q, const quvi_subtitle_t qsub,
+                            const gchar *lang, const lutil_cb_printerr xperr,
+                            GSList **l, const gboolean fail_if_none)
+{
+  gchar **v;
+  GSList *ids;
+  gint i, r;
+
+  g_assert(lang != NULL);
+  g_assert(l != NULL);
+
+  v = g_strsplit(lang, ";", 0);
+  r = EXIT_SUCCESS;
+  ids = NULL;
+  *l = NULL;
+
+  for (i=0; v[i] != NULL && r == EXIT_SUCCESS; ++i)
+    {
+      quvi_subtitle_lang_t ql;
+      const gchar *s;
+
+      if (strlen(g_strstrip(v[i])) ==0)
+        continue;
+
+      r = lutil_choose_subtitle(q, qsub, v[i], xperr, &ql, fail_if_none);
+      if (r != EXIT_SUCCESS || ql == NULL)
+        continue;
+
+      quvi_subtitle_lang_get(ql, QUVI_SUBTITLE_LANG_PROPERTY_ID, &s);
+
+      if (g_slist_find_custom(ids, s, (GCompareFunc) g_strcmp0) == NULL)
+        {
+          ids = g_slist_prepend(ids, g_strdup(s));
+          *l = g_slist_prepend(*l, ql);
+        }
+    }
+  lutil_slist_free_full(ids, (GFunc) g_free);
+  g_strfreev(v);
+
+  *l = g_slist_reverse(*l);
+  return (r);
+}
+
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -66,6 +66,7 @@ gint lutil_exec_cmd(lutil_exec_opts_t opts)
   memset(&xopts, 0, sizeof(struct lutil_xchg_seq_opts_s));
 
   xopts.file_ext = opts->file_ext;
+  xopts.checksum = opts->checksum;
   xopts.fpath = opts->fpath;
   xopts.xperr = opts->xperr;
   xopts.qm = opts->qm;
@@ -95,6 +96,8 @@ gint lutil_exec_cmd(lutil_exec_opts_t opts)
   if (opts->flags.discard_stdout == TRUE)
     flags |= G_SPAWN_STDOUT_TO_DEV_NULL;
 
+  lutil_trace_begin("quvi", "exec", NULL);
+
   if (g_spawn_async(NULL, argv, NULL, flags,
                     NULL, NULL, &pid, &e) == FALSE)
     {
@@ -104,6 +107,8 @@ gint lutil_exec_cmd(lutil_exec_opts_t opts)
       g_error_free(e);
     }
 
+  lutil_trace_end("quvi", "exec");
+
   g_strfreev(argv);
   return (r);
 }
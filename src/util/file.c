@@ -21,6 +21,12 @@
 #include "config.h"
 
 #include <stdlib.h>
+#ifdef HAVE_SYS_STATVFS_H
+#include <sys/statvfs.h>
+#endif
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
 #include <glib/gstdio.h>
 #include <glib/gi18n.h>
 
@@ -90,4 +96,77 @@ gint lutil_file_open(lutil_file_open_t p)
   return (EXIT_SUCCESS);
 }
 
+/*
+ * Check that the file system of the path has room for the bytes, plus
+ * the margin. The check passes if the free space cannot be determined,
+ * the transfer will then fail on the write, as before.
+ */
+gint lutil_file_chk_space(const gchar *path, const gdouble bytes,
+                          const gdouble margin,
+                          const lutil_cb_printerr xperr)
+{
+#ifdef HAVE_STATVFS
+  struct statvfs b;
+  gdouble avail;
+
+  g_assert(path != NULL);
+  g_assert(xperr != NULL);
+
+  if (statvfs(path, &b) != 0)
+    return (EXIT_SUCCESS);
+
+  avail = (gdouble) b.f_bavail * b.f_frsize;
+  if (bytes + margin <= avail)
+    return (EXIT_SUCCESS);
+
+  xperr(_("%s: not enough free space: %.1fMi required "
+          "(%.1fMi + %.1fMi margin), %.1fMi available"),
+        path, (bytes + margin) / 1048576, bytes / 1048576,
+        margin / 1048576, avail / 1048576);
+
+  return (EXIT_FAILURE);
+#else
+  return (EXIT_SUCCESS);
+#endif
+}
+
+/*
+ * Reserve the blocks for the bytes past the offset, without changing
+ * the file size: the resume check reads the size from g_stat. Quietly
+ * does nothing if the file system does not support it.
+ */
+gint lutil_file_preallocate(lutil_file_open_t p, const gdouble bytes)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+  gchar *s;
+  gint fd;
+
+  g_assert(p != NULL);
+  g_assert(p->result.file != NULL);
+
+  if (bytes <= 0)
+    return (EXIT_SUCCESS);
+
+  fd = fileno((FILE*) p->result.file);
+
+  if (fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t) p->result.initial_bytes,
+                (off_t) bytes) == 0)
+    {
+      return (EXIT_SUCCESS);
+    }
+
+  if (errno != ENOSPC && errno != EDQUOT && errno != EFBIG)
+    return (EXIT_SUCCESS); /* EOPNOTSUPP and such */
+
+  s = lutil_strerror();
+  p->xperr(_("while preallocating %.0f bytes for file: %s: %s"),
+           bytes, p->fpath, s);
+  g_free(s);
+
+  return (EXIT_FAILURE);
+#else
+  return (EXIT_SUCCESS);
+#endif
+}
+
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
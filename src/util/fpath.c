@@ -21,11 +21,101 @@
 #include "config.h"
 
 #include <string.h>
+#include <glib/gstdio.h>
 #include <glib/gi18n.h>
 #include <quvi.h>
 
 #include "lutil.h"
 
+/*
+ * The shard key: the media ID, or the file name without the extension,
+ * if the media script did not return an ID.
+ */
+static gchar *_shard_key(lutil_build_fpath_t p, const gchar *fname)
+{
+  gchar *media_id, *s, *e;
+
+  quvi_media_get(p->qm, QUVI_MEDIA_PROPERTY_ID, &media_id);
+
+  if (media_id != NULL && strlen(media_id) >0)
+    return (g_strdup(media_id));
+
+  s = g_strdup(fname);
+  e = strrchr(s, '.');
+
+  if (e != NULL && e != s)
+    *e = '\0';
+
+  return (s);
+}
+
+/* Two levels of two characters, e.g. "ab/cd". */
+static gchar *_shard_dir(lutil_build_fpath_t p, const gchar *fname)
+{
+  gchar d[4], *key, *r;
+  gsize i, n;
+
+  key = _shard_key(p, fname);
+
+  if (p->output_shard == UTIL_OUTPUT_SHARD_HASH)
+    {
+      struct lutil_sha256_s sha;
+
+      lutil_sha256_init(&sha);
+      lutil_sha256_update(&sha, key, strlen(key));
+
+      g_free(key);
+      key = lutil_sha256_hex(&sha);
+    }
+
+  n = strlen(key);
+
+  for (i=0; i<4; ++i)
+    {
+      d[i] = (i < n && g_ascii_isalnum(key[i]) == TRUE)
+             ? key[i]
+             : '_';
+    }
+  g_free(key);
+
+  r = g_strdup_printf("%c%c%s%c%c", d[0], d[1], G_DIR_SEPARATOR_S,
+                      d[2], d[3]);
+  return (r);
+}
+
+/* Insert the shard directories to the path, and create them. */
+static gchar *_shard(lutil_build_fpath_t p, gchar *fpath)
+{
+  gchar *fname, *dname, *shard, *r;
+
+  fname = g_path_get_basename(fpath);
+  dname = g_path_get_dirname(fpath);
+  shard = _shard_dir(p, fname);
+
+  r = g_build_path(G_DIR_SEPARATOR_S, dname, shard, NULL);
+
+  g_free(shard);
+  g_free(dname);
+  g_free(fpath);
+
+  if (g_mkdir_with_parents(r, 0755) !=0)
+    {
+      gchar *e = lutil_strerror();
+      p->xperr(_("while creating directory: %s: %s"), r, e);
+      g_free(fname);
+      g_free(e);
+      g_free(r);
+      return (NULL);
+    }
+
+  fpath = g_build_path(G_DIR_SEPARATOR_S, r, fname, NULL);
+
+  g_free(fname);
+  g_free(r);
+
+  return (fpath);
+}
+
 gchar *lutil_build_fpath(lutil_build_fpath_t p)
 {
   gchar *fname, *fpath;
@@ -70,6 +160,14 @@ gchar *lutil_build_fpath(lutil_build_fpath_t p)
     }
 
   g_free(fname);
+
+  /* Shard the names generated from --output-name only. */
+  if (p->output_shard != UTIL_OUTPUT_SHARD_NONE
+      && (p->output_file == NULL || strlen(p->output_file) ==0))
+    {
+      fpath = _shard(p, fpath);
+    }
+
   return (fpath);
 }
 
@@ -0,0 +1,230 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The media-ID index maps (site, media ID, stream ID) to the path of
+ * the file the media stream was saved to. It is kept in a plain text
+ * file, one tab-separated record per line, and records are only ever
+ * appended; a later record of the same key overrides an earlier one.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+static struct
+{
+  lutil_cb_printerr xperr;
+  GHashTable *records;
+  gchar *fpath;
+  GMutex lock;
+} x;
+
+/* The domain is recorded as it is, and keyed by its site. */
+static gchar *_key(const gchar *domain, const gchar *media_id,
+                   const gchar *stream_id)
+{
+  gchar *site, *r;
+
+  site = lutil_url_site(domain);
+  r = g_strjoin("\t", site, media_id, stream_id, NULL);
+  g_free(site);
+
+  return (r);
+}
+
+static void _load(const gchar *s)
+{
+  gchar **l;
+  gint i;
+
+  l = g_strsplit(s, "\n", 0);
+  for (i=0; l[i] != NULL; ++i)
+    {
+      gchar **v = g_strsplit(l[i], "\t", 4);
+
+      if (g_strv_length(v) ==4 && strlen(v[1]) >0 && strlen(v[3]) >0)
+        {
+          g_hash_table_replace(x.records, _key(v[0], v[1], v[2]),
+                               g_strdup(v[3]));
+        }
+      g_strfreev(v);
+    }
+  g_strfreev(l);
+}
+
+gint lutil_index_init(const gchar *fpath, const lutil_cb_printerr xperr)
+{
+  GError *e;
+  gchar *s;
+
+  g_assert(x.fpath == NULL);
+  g_assert(fpath != NULL);
+  g_assert(xperr != NULL);
+
+  x.records = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                    g_free, g_free);
+  x.fpath = g_strdup(fpath);
+  x.xperr = xperr;
+
+  g_mutex_init(&x.lock);
+
+  if (g_file_test(fpath, G_FILE_TEST_EXISTS) == FALSE)
+    return (EXIT_SUCCESS);
+
+  e = NULL;
+  s = NULL;
+
+  if (g_file_get_contents(fpath, &s, NULL, &e) == FALSE)
+    {
+      xperr(_("while reading the index: %s"), e->message);
+      g_error_free(e);
+      lutil_index_close();
+      return (EXIT_FAILURE);
+    }
+
+  _load(s);
+  g_free(s);
+
+  return (EXIT_SUCCESS);
+}
+
+gboolean lutil_index_enabled()
+{
+  return ((x.fpath != NULL) ? TRUE:FALSE);
+}
+
+/*
+ * Return the path to the file of the media stream, or NULL if there is
+ * no record of it, or if the file no longer exists.
+ */
+gchar *lutil_index_lookup(const gchar *domain, const gchar *media_id,
+                          const gchar *stream_id)
+{
+  const gchar *s;
+  gchar *k, *r;
+
+  if (x.fpath == NULL || domain == NULL || media_id == NULL
+      || strlen(media_id) ==0)
+    {
+      return (NULL);
+    }
+
+  k = _key(domain, media_id, (stream_id != NULL) ? stream_id:"");
+  r = NULL;
+
+  g_mutex_lock(&x.lock);
+
+  s = g_hash_table_lookup(x.records, k);
+  if (s != NULL && g_file_test(s, G_FILE_TEST_IS_REGULAR) == TRUE)
+    r = g_strdup(s);
+
+  g_mutex_unlock(&x.lock);
+
+  g_free(k);
+  return (r);
+}
+
+gint lutil_index_add(const gchar *domain, const gchar *media_id,
+                     const gchar *stream_id, const gchar *file)
+{
+  const gchar *s;
+  gchar *k;
+  FILE *f;
+  gint r;
+
+  g_assert(file != NULL);
+
+  if (x.fpath == NULL || domain == NULL || media_id == NULL
+      || strlen(media_id) ==0 || strpbrk(file, "\t\n") != NULL)
+    {
+      return (EXIT_SUCCESS);
+    }
+
+  if (stream_id == NULL)
+    stream_id = "";
+
+  k = _key(domain, media_id, stream_id);
+  r = EXIT_SUCCESS;
+
+  g_mutex_lock(&x.lock);
+
+  s = g_hash_table_lookup(x.records, k);
+  if (g_strcmp0(s, file) ==0) /* Recorded already. */
+    {
+      g_mutex_unlock(&x.lock);
+      g_free(k);
+      return (r);
+    }
+
+  r = EXIT_FAILURE;
+  f = g_fopen(x.fpath, "a");
+
+  if (f != NULL)
+    {
+      if (fprintf(f, "%s\t%s\t%s\t%s\n",
+                  domain, media_id, stream_id, file) >0)
+        {
+          r = EXIT_SUCCESS;
+        }
+      if (fclose(f) != 0)
+        r = EXIT_FAILURE;
+    }
+
+  if (r == EXIT_SUCCESS)
+    {
+      g_hash_table_replace(x.records, k, g_strdup(file));
+      k = NULL;
+    }
+  else
+    {
+      gchar *e = lutil_strerror();
+      x.xperr(_("while writing to file: %s: %s"), x.fpath, e);
+      g_free(e);
+    }
+
+  g_mutex_unlock(&x.lock);
+
+  g_free(k);
+  return (r);
+}
+
+void lutil_index_close()
+{
+  if (x.fpath == NULL)
+    return;
+
+  g_hash_table_destroy(x.records);
+  x.records = NULL;
+
+  g_mutex_clear(&x.lock);
+
+  g_free(x.fpath);
+  x.fpath = NULL;
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
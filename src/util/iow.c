@@ -0,0 +1,789 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The writer of the media file. By default, the data is written with
+ * stdio in the curl write callback. With io_uring (--with-liburing),
+ * the data is copied to one of the registered buffers, and a full
+ * buffer is submitted as a write of its own; the write callback waits
+ * only if all of the buffers are still being written. The stdio writer
+ * is used if the ring cannot be set up, e.g. on older kernels.
+ *
+ * --page-cache: with 'dontneed', the written pages are dropped from
+ * the page cache behind the write cursor, a window at a time. With
+ * 'direct', the file is written with O_DIRECT from aligned buffers:
+ * the unaligned head (a resumed file) and tail are written through the
+ * page cache, and dropped once the file is complete. If O_DIRECT is
+ * not supported by the file system, 'dontneed' is used instead.
+ *
+ * --write-buffer: the data is passed to a writer thread through a ring
+ * buffer, so that the disk does not hold up the receive. The caller
+ * checks lutil_iow_ready first, and pauses the transfer until
+ * lutil_iow_resume, should the buffer be full.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <glib.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "lutil.h"
+
+#define BUFFER_SIZE (256*1024)
+#define DROP_WINDOW (8*1024*1024)
+#define ALIGN 4096
+
+#ifdef HAVE_LIBURING
+#define N_BUFFERS 8
+
+struct buffer_s
+{
+  struct iovec iov;
+  gboolean busy; /* submitted */
+  gsize done; /* bytes written of the submitted */
+  gsize fill;
+  off_t offset;
+};
+#endif
+
+struct lutil_iow_s
+{
+  struct lutil_iow_stats_s stats;
+  lutilPageCache cache;
+  gboolean aligned; /* --page-cache direct */
+  gboolean direct; /* O_DIRECT is set */
+  off_t dropped; /* dropped from the page cache, up to */
+  off_t flushed; /* writeback started, up to */
+  off_t offset; /* of the next write */
+  gsize head; /* unaligned bytes to write before O_DIRECT */
+  gint error; /* errno of the first failed write */
+  gchar *buf; /* aligned, without io_uring */
+  gsize fill;
+  FILE *file;
+  gint fd;
+  struct
+  {
+    gint64 stalled; /* since, 0 if not */
+    gdouble fill_sum;
+    lutil_ring_t ring;
+    GThread *thread;
+    guint samples;
+    gint closing;
+    GMutex lock;
+    GCond cond;
+    gint idle;
+  } a; /* --write-buffer */
+#ifdef HAVE_LIBURING
+  struct buffer_s b[N_BUFFERS];
+  struct io_uring ring;
+  gboolean uring;
+  gint pending;
+  gint curr;
+#endif
+};
+
+static gchar *_aligned_new()
+{
+  gpointer p;
+
+  if (posix_memalign(&p, ALIGN, BUFFER_SIZE) !=0)
+    return (NULL);
+
+  return ((gchar*) p);
+}
+
+static gboolean _set_flag(const gint fd, const gint flag, const gboolean on)
+{
+  gint f = fcntl(fd, F_GETFL);
+
+  if (f == -1)
+    return (FALSE);
+
+  f = (on == TRUE) ? (f | flag) : (f & ~flag);
+  return ((fcntl(fd, F_SETFL, f) != -1) ? TRUE:FALSE);
+}
+
+static void _set_direct(lutil_iow_t w, const gboolean on)
+{
+#ifdef O_DIRECT
+  if (w->direct == on)
+    return;
+
+  if (_set_flag(w->fd, O_DIRECT, on) == TRUE)
+    w->direct = on;
+  else if (on == TRUE)
+    w->cache = UTIL_PAGE_CACHE_DONTNEED; /* Not supported. */
+#else
+  w->cache = UTIL_PAGE_CACHE_DONTNEED;
+#endif
+}
+
+/* Drop the pages written up to 'done' from the page cache. */
+static void _drop_behind(lutil_iow_t w, const off_t done)
+{
+#ifdef HAVE_POSIX_FADVISE
+  if (w->cache != UTIL_PAGE_CACHE_DONTNEED || done - w->flushed < DROP_WINDOW)
+    return;
+#ifdef HAVE_SYNC_FILE_RANGE
+  /*
+   * Start the writeback of this window, wait for that of the previous
+   * one: the pages must be clean before they can be dropped.
+   */
+  sync_file_range(w->fd, w->flushed, done - w->flushed,
+                  SYNC_FILE_RANGE_WRITE);
+
+  if (w->flushed > w->dropped)
+    {
+      sync_file_range(w->fd, w->dropped, w->flushed - w->dropped,
+                      SYNC_FILE_RANGE_WAIT_BEFORE
+                      | SYNC_FILE_RANGE_WRITE
+                      | SYNC_FILE_RANGE_WAIT_AFTER);
+      posix_fadvise(w->fd, w->dropped, w->flushed - w->dropped,
+                    POSIX_FADV_DONTNEED);
+      w->dropped = w->flushed;
+    }
+#else
+  fdatasync(w->fd);
+  posix_fadvise(w->fd, w->dropped, done - w->dropped, POSIX_FADV_DONTNEED);
+  w->dropped = done;
+#endif
+  w->flushed = done;
+#endif /* HAVE_POSIX_FADVISE */
+}
+
+/* Write at the offset, synchronously. */
+static gint _pwrite(lutil_iow_t w, const gchar *p, gsize n)
+{
+  while (n >0)
+    {
+      ssize_t r = pwrite(w->fd, p, n, w->offset);
+      if (r <0)
+        {
+          if (errno == EINTR)
+            continue;
+          w->error = errno;
+          return (EXIT_FAILURE);
+        }
+      w->offset += r;
+      p += r;
+      n -= r;
+    }
+  return (EXIT_SUCCESS);
+}
+
+/* Write the unaligned head of a resumed file, then set O_DIRECT. */
+static gint _write_head(lutil_iow_t w, const gchar **p, gsize *n)
+{
+  gsize k = MIN(*n, w->head);
+
+  if (_pwrite(w, *p, k) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  w->head -= k;
+  *p += k;
+  *n -= k;
+
+  if (w->head ==0)
+    _set_direct(w, TRUE);
+
+  return (EXIT_SUCCESS);
+}
+
+/*
+ * Write the rest of the data, which may be shorter than a block: the
+ * aligned part with O_DIRECT, the unaligned tail through the page cache.
+ */
+static gint _write_tail(lutil_iow_t w, const gchar *p, const gsize n)
+{
+  gsize a = n - n % ALIGN;
+
+  if (a >0 && _pwrite(w, p, a) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  _set_direct(w, FALSE);
+  return (_pwrite(w, p+a, n-a));
+}
+
+#ifdef HAVE_LIBURING
+
+static void _uring_free(lutil_iow_t);
+
+static gboolean _uring_init(lutil_iow_t w)
+{
+  struct iovec v[N_BUFFERS];
+  gint i;
+
+  if (io_uring_queue_init(N_BUFFERS, &w->ring, 0) <0)
+    return (FALSE);
+
+  for (i=0; i<N_BUFFERS; ++i)
+    {
+      w->b[i].iov.iov_base = _aligned_new();
+      w->b[i].iov.iov_len = BUFFER_SIZE;
+      v[i] = w->b[i].iov;
+
+      if (v[i].iov_base == NULL)
+        {
+          _uring_free(w);
+          return (FALSE);
+        }
+    }
+
+  if (io_uring_register_buffers(&w->ring, v, N_BUFFERS) <0)
+    {
+      _uring_free(w);
+      return (FALSE);
+    }
+  return (TRUE);
+}
+
+static gint _uring_submit(lutil_iow_t w, const gint i)
+{
+  struct buffer_s *b;
+  struct io_uring_sqe *e;
+
+  b = &w->b[i];
+  e = io_uring_get_sqe(&w->ring);
+
+  if (e == NULL) /* Cannot happen: one entry per buffer. */
+    {
+      w->error = EBUSY;
+      return (EXIT_FAILURE);
+    }
+
+  io_uring_prep_write_fixed(e, w->fd, (gchar*) b->iov.iov_base + b->done,
+                            b->fill - b->done, b->offset + b->done, i);
+  io_uring_sqe_set_data(e, b);
+
+  if (b->busy == FALSE)
+    {
+      b->busy = TRUE;
+      ++w->pending;
+    }
+
+  if (io_uring_submit(&w->ring) <0)
+    {
+      w->error = EIO;
+      return (EXIT_FAILURE);
+    }
+  return (EXIT_SUCCESS);
+}
+
+/* Reap a completion, wait for one if 'wait' is TRUE. */
+static gboolean _uring_reap(lutil_iow_t w, const gboolean wait)
+{
+  struct io_uring_cqe *e;
+  struct buffer_s *b;
+  gint r;
+
+  r = (wait == TRUE)
+      ? io_uring_wait_cqe(&w->ring, &e)
+      : io_uring_peek_cqe(&w->ring, &e);
+
+  if (r <0)
+    {
+      if (wait == TRUE && w->error ==0)
+        w->error = -r;
+      return (FALSE);
+    }
+
+  b = (struct buffer_s*) io_uring_cqe_get_data(e);
+  r = e->res;
+  io_uring_cqe_seen(&w->ring, e);
+
+  if (r <=0)
+    {
+      if (w->error ==0)
+        w->error = (r <0) ? -r : EIO;
+    }
+  else
+    {
+      b->done += r;
+      if (b->done < b->fill && w->error ==0) /* Short write. */
+        {
+          _uring_submit(w, b - w->b);
+          return (TRUE);
+        }
+    }
+
+  b->busy = FALSE;
+  b->fill = 0;
+  b->done = 0;
+  --w->pending;
+
+  return (TRUE);
+}
+
+/* Return the offset up to which all of the writes have completed. */
+static off_t _uring_done(lutil_iow_t w)
+{
+  off_t r;
+  gint i;
+
+  for (i=0, r=w->offset; i<N_BUFFERS; ++i)
+    {
+      if (w->b[i].busy == TRUE && w->b[i].offset < r)
+        r = w->b[i].offset;
+    }
+  return (r);
+}
+
+/* Submit the current buffer and advance to the next free one. */
+static gint _uring_flush(lutil_iow_t w)
+{
+  struct buffer_s *b = &w->b[w->curr];
+
+  if (b->fill ==0)
+    return (EXIT_SUCCESS);
+
+  b->offset = w->offset;
+  w->offset += b->fill;
+
+  if (_uring_submit(w, w->curr) != EXIT_SUCCESS)
+    return (EXIT_FAILURE);
+
+  w->curr = (w->curr+1) % N_BUFFERS;
+
+  while (_uring_reap(w, FALSE) == TRUE); /* Those completed already. */
+
+  while (w->b[w->curr].busy == TRUE && w->error ==0)
+    _uring_reap(w, TRUE);
+
+  _drop_behind(w, _uring_done(w));
+
+  return ((w->error ==0) ? EXIT_SUCCESS:EXIT_FAILURE);
+}
+
+static gint _uring_write(lutil_iow_t w, const gchar *p, gsize n)
+{
+  while (n >0 && w->error ==0)
+    {
+      struct buffer_s *b;
+      gsize k;
+
+      b = &w->b[w->curr];
+      k = MIN(n, BUFFER_SIZE - b->fill);
+
+      memcpy((gchar*) b->iov.iov_base + b->fill, p, k);
+      b->fill += k;
+      p += k;
+      n -= k;
+
+      if (b->fill == BUFFER_SIZE)
+        _uring_flush(w);
+    }
+  return ((w->error ==0) ? EXIT_SUCCESS:EXIT_FAILURE);
+}
+
+static gint _uring_sync(lutil_iow_t w)
+{
+  struct buffer_s *b = &w->b[w->curr];
+
+  if (w->error ==0 && w->aligned == FALSE)
+    _uring_flush(w);
+
+  while (w->pending >0)
+    {
+      if (_uring_reap(w, TRUE) == FALSE)
+        break;
+    }
+
+  /* O_DIRECT: the partial buffer is the tail of the file. */
+  if (w->error ==0 && w->aligned == TRUE && b->fill >0)
+    {
+      _write_tail(w, b->iov.iov_base, b->fill);
+      b->fill = 0;
+    }
+  return ((w->error ==0) ? EXIT_SUCCESS:EXIT_FAILURE);
+}
+
+static void _uring_free(lutil_iow_t w)
+{
+  gint i;
+
+  io_uring_queue_exit(&w->ring); /* Unregisters the buffers. */
+
+  for (i=0; i<N_BUFFERS; ++i)
+    free(w->b[i].iov.iov_base);
+}
+
+#endif /* HAVE_LIBURING */
+
+/* O_DIRECT without io_uring: write the aligned buffer when full. */
+static gint _aligned_write(lutil_iow_t w, const gchar *p, gsize n)
+{
+  while (n >0 && w->error ==0)
+    {
+      gsize k = MIN(n, BUFFER_SIZE - w->fill);
+
+      memcpy(w->buf + w->fill, p, k);
+      w->fill += k;
+      p += k;
+      n -= k;
+
+      if (w->fill == BUFFER_SIZE)
+        {
+          _pwrite(w, w->buf, w->fill);
+          _drop_behind(w, w->offset);
+          w->fill = 0;
+        }
+    }
+  return ((w->error ==0) ? EXIT_SUCCESS:EXIT_FAILURE);
+}
+
+static gint _stdio_write(lutil_iow_t w, gconstpointer p, const gsize n)
+{
+  if (fwrite(p, 1, n, w->file) != n)
+    return (EXIT_FAILURE);
+
+  if (fflush(w->file) != 0)
+    return (EXIT_FAILURE);
+
+  w->offset += n;
+  _drop_behind(w, w->offset);
+
+  return (EXIT_SUCCESS);
+}
+
+/* Return TRUE if the data is written by offset, not with stdio. */
+static gboolean _by_offset(lutil_iow_t w)
+{
+#ifdef HAVE_LIBURING
+  if (w->uring == TRUE)
+    return (TRUE);
+#endif
+  return (w->aligned);
+}
+
+static void _aligned_init(lutil_iow_t w)
+{
+#ifdef HAVE_LIBURING
+  if (w->uring == FALSE)
+#endif
+    {
+      w->buf = _aligned_new();
+      if (w->buf == NULL)
+        {
+          w->cache = UTIL_PAGE_CACHE_DONTNEED;
+          return;
+        }
+    }
+
+  w->aligned = TRUE;
+  w->head = (ALIGN - w->offset % ALIGN) % ALIGN;
+
+  if (w->head ==0)
+    _set_direct(w, TRUE);
+}
+
+static gint _write(lutil_iow_t w, gconstpointer data, gsize n)
+{
+  const gchar *p;
+  gint r;
+
+  p = (const gchar*) data;
+  r = EXIT_SUCCESS;
+
+  if (w->error ==0 && w->head >0)
+    r = _write_head(w, &p, &n);
+
+  if (w->error !=0)
+    r = EXIT_FAILURE;
+#ifdef HAVE_LIBURING
+  else if (w->uring == TRUE)
+    r = _uring_write(w, p, n);
+#endif
+  else if (w->aligned == TRUE)
+    r = _aligned_write(w, p, n);
+  else
+    return (_stdio_write(w, p, n)); /* errno is set */
+
+  if (r != EXIT_SUCCESS)
+    errno = w->error;
+
+  return (r);
+}
+
+static void _wait_for_data(lutil_iow_t w)
+{
+  g_mutex_lock(&w->a.lock);
+  g_atomic_int_set(&w->a.idle, 1);
+
+  if (lutil_ring_fill(w->a.ring) ==0 && g_atomic_int_get(&w->a.closing) ==0)
+    {
+      g_cond_wait_until(&w->a.cond, &w->a.lock,
+                        g_get_monotonic_time() + G_TIME_SPAN_SECOND/10);
+    }
+
+  g_atomic_int_set(&w->a.idle, 0);
+  g_mutex_unlock(&w->a.lock);
+}
+
+static void _wake(lutil_iow_t w, const gboolean always)
+{
+  if (always == FALSE && g_atomic_int_get(&w->a.idle) ==0)
+    return;
+
+  g_mutex_lock(&w->a.lock);
+  g_cond_signal(&w->a.cond);
+  g_mutex_unlock(&w->a.lock);
+}
+
+static gpointer _writer(gpointer p)
+{
+  lutil_iow_t w = (lutil_iow_t) p;
+
+  for (;;)
+    {
+      gconstpointer d;
+      gsize n;
+
+      n = lutil_ring_peek(w->a.ring, &d);
+      if (n >0)
+        {
+          /* Keep draining after an error, the producer must not block. */
+          if (g_atomic_int_get(&w->error) ==0
+              && _write(w, d, n) != EXIT_SUCCESS)
+            {
+              g_atomic_int_set(&w->error, (errno !=0) ? errno:EIO);
+            }
+          lutil_ring_consume(w->a.ring, n);
+        }
+      else if (g_atomic_int_get(&w->a.closing) ==1)
+        {
+          if (lutil_ring_fill(w->a.ring) ==0)
+            break;
+        }
+      else
+        _wait_for_data(w);
+    }
+  return (NULL);
+}
+
+static void _async_init(lutil_iow_t w, const gsize size)
+{
+  GError *e = NULL;
+
+  g_mutex_init(&w->a.lock);
+  g_cond_init(&w->a.cond);
+
+  w->a.ring = lutil_ring_new(size);
+  w->a.thread = g_thread_try_new("writer", _writer, w, &e);
+
+  if (w->a.thread == NULL) /* Write in the caller's thread. */
+    {
+      g_error_free(e);
+      lutil_ring_free(w->a.ring);
+      w->a.ring = NULL;
+      return;
+    }
+  w->stats.size = lutil_ring_size(w->a.ring);
+}
+
+/* Push the data to the ring, wait for the room if necessary. */
+static gint _push(lutil_iow_t w, const gchar *p, gsize n)
+{
+  while (n >0)
+    {
+      gsize k, f;
+
+      if (g_atomic_int_get(&w->error) !=0)
+        {
+          errno = g_atomic_int_get(&w->error);
+          return (EXIT_FAILURE);
+        }
+
+      k = lutil_ring_push(w->a.ring, p, n);
+      p += k;
+      n -= k;
+
+      f = lutil_ring_fill(w->a.ring);
+      w->stats.fill_peak = MAX(w->stats.fill_peak, f);
+      w->a.fill_sum += f;
+      ++w->a.samples;
+
+      _wake(w, FALSE);
+
+      if (n >0) /* Full: lutil_iow_ready was not checked. */
+        g_usleep(1000);
+    }
+  return (EXIT_SUCCESS);
+}
+
+/* Return TRUE if n bytes can be written without waiting. */
+gboolean lutil_iow_ready(lutil_iow_t w, const gsize n)
+{
+  gsize f;
+
+  if (w->a.ring == NULL)
+    return (TRUE);
+
+  f = lutil_ring_fill(w->a.ring);
+  if (f ==0 || n <= lutil_ring_size(w->a.ring) - f)
+    return (TRUE);
+
+  if (w->a.stalled ==0)
+    {
+      w->a.stalled = g_get_monotonic_time();
+      ++w->stats.stalls;
+    }
+  return (FALSE);
+}
+
+/* Return TRUE once a stalled buffer has drained to half. */
+gboolean lutil_iow_resume(lutil_iow_t w)
+{
+  if (w->a.ring == NULL)
+    return (TRUE);
+
+  if (lutil_ring_fill(w->a.ring) > lutil_ring_size(w->a.ring)/2)
+    return (FALSE);
+
+  if (w->a.stalled >0)
+    {
+      w->stats.stall_time +=
+        (gdouble) (g_get_monotonic_time() - w->a.stalled) / G_USEC_PER_SEC;
+      w->a.stalled = 0;
+    }
+  return (TRUE);
+}
+
+void lutil_iow_stats(const lutil_iow_t w, lutil_iow_stats_t s)
+{
+  memcpy(s, &w->stats, sizeof(struct lutil_iow_stats_s));
+
+  if (w->a.samples >0)
+    s->fill_mean = w->a.fill_sum / w->a.samples;
+}
+
+/*
+ * Return a new writer for the file opened with lutil_file_open. The
+ * data is written at the end of the file. If buffer_size >0, the data
+ * is written in a thread of its own.
+ */
+lutil_iow_t lutil_iow_new(gpointer file, const lutilPageCache cache,
+                          const gsize buffer_size)
+{
+  lutil_iow_t w;
+
+  g_assert(file != NULL);
+
+  w = g_new0(struct lutil_iow_s, 1);
+  w->file = (FILE*) file;
+  w->fd = fileno(w->file);
+  w->cache = cache;
+
+  fflush(w->file);
+
+  w->offset = lseek(w->fd, 0, SEEK_END);
+  w->dropped = w->offset;
+  w->flushed = w->offset;
+
+#ifdef HAVE_LIBURING
+  w->uring = _uring_init(w);
+#endif
+
+  if (cache == UTIL_PAGE_CACHE_DIRECT)
+    _aligned_init(w);
+
+  /* Written by offset: the writes may complete in any order. */
+  if (_by_offset(w) == TRUE && _set_flag(w->fd, O_APPEND, FALSE) == FALSE)
+    w->error = errno;
+
+  if (buffer_size >0 && w->error ==0)
+    _async_init(w, buffer_size);
+
+  return (w);
+}
+
+gint lutil_iow_write(lutil_iow_t w, gconstpointer data, const gsize n)
+{
+  if (w->a.ring != NULL)
+    return (_push(w, (const gchar*) data, n));
+
+  return (_write(w, data, n));
+}
+
+/* Wait for the pending writes, and free the writer. */
+gint lutil_iow_free(lutil_iow_t w)
+{
+  gint r;
+
+  if (w == NULL)
+    return (EXIT_SUCCESS);
+
+  if (w->a.ring != NULL)
+    {
+      g_atomic_int_set(&w->a.closing, 1);
+      _wake(w, TRUE);
+      g_thread_join(w->a.thread);
+
+      lutil_ring_free(w->a.ring);
+      g_mutex_clear(&w->a.lock);
+      g_cond_clear(&w->a.cond);
+    }
+
+  r = EXIT_SUCCESS;
+#ifdef HAVE_LIBURING
+  if (w->uring == TRUE)
+    {
+      r = _uring_sync(w);
+      _uring_free(w);
+    }
+  else
+#endif
+  if (w->aligned == TRUE && w->error ==0 && w->fill >0)
+    r = _write_tail(w, w->buf, w->fill);
+
+  if (w->error !=0)
+    r = EXIT_FAILURE;
+
+  _set_direct(w, FALSE);
+
+#ifdef HAVE_POSIX_FADVISE
+  /* Drop what is left of the file in the page cache. */
+  if (r == EXIT_SUCCESS && w->cache != UTIL_PAGE_CACHE_KEEP
+      && w->offset > w->dropped)
+    {
+      fdatasync(w->fd);
+      posix_fadvise(w->fd, w->dropped, w->offset - w->dropped,
+                    POSIX_FADV_DONTNEED);
+    }
+#endif
+
+  if (r != EXIT_SUCCESS)
+    errno = w->error;
+
+  free(w->buf);
+  g_free(w);
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
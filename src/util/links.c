@@ -0,0 +1,157 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <quvi.h>
+#include <curl/curl.h>
+
+#include "lutil.h"
+
+/* Stop reading the page after this many bytes. */
+#define PAGE_MAX_BYTES (4*1024*1024)
+
+static const gchar *re_links =
+  "(?:href|src)\\s*=\\s*[\"']([^\"'#<>\\s]+)";
+
+struct _page_s
+{
+  GString *data;
+  CURL *c;
+};
+
+typedef struct _page_s *_page_t;
+
+static gboolean _is_html(CURL *c)
+{
+  gchar *ct = NULL;
+  curl_easy_getinfo(c, CURLINFO_CONTENT_TYPE, &ct);
+  return ((ct == NULL || g_ascii_strncasecmp(ct, "text/html", 9) ==0)
+          ? TRUE
+          : FALSE);
+}
+
+static gsize _write_cb(gpointer b, gsize sz, gsize n, gpointer d)
+{
+  const gsize rsize = sz*n;
+  _page_t p = (_page_t) d;
+
+  /* Do not read media files: the headers are in by now. */
+  if (p->data->len ==0 && _is_html(p->c) == FALSE)
+    return (0); /* Abort transfer. */
+
+  if (p->data->len + rsize > PAGE_MAX_BYTES)
+    return (0);
+
+  g_string_append_len(p->data, b, rsize);
+  return (rsize);
+}
+
+static void _reset_curl(CURL *c)
+{
+  curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, NULL);
+  curl_easy_setopt(c, CURLOPT_WRITEDATA, NULL);
+  curl_easy_setopt(c, CURLOPT_HTTPGET, 1L);
+}
+
+static GSList *_extract(const gchar *base, const gchar *data)
+{
+  GMatchInfo *m;
+  GSList *r;
+  GRegex *re;
+
+  re = g_regex_new(re_links, G_REGEX_CASELESS|G_REGEX_RAW, 0, NULL);
+  g_assert(re != NULL);
+
+  g_regex_match(re, data, 0, &m);
+  r = NULL;
+
+  while (g_match_info_matches(m) == TRUE)
+    {
+      gchar *s = g_match_info_fetch(m, 1);
+      gchar *u = lutil_url_resolve(base, s);
+
+      if (u != NULL)
+        {
+          r = lutil_slist_prepend_if_unique(r, u);
+          g_free(u);
+        }
+      g_match_info_next(m, NULL);
+      g_free(s);
+    }
+  g_match_info_free(m);
+  g_regex_unref(re);
+
+  return (g_slist_reverse(r));
+}
+
+/*
+ * Check whether the URL is an HTML page, using the libcURL handle of
+ * the quvi_t. Unless links is NULL, fetch the page, and set links to
+ * the absolute http(s) URLs it links to; otherwise send a HEAD request
+ * only.
+ */
+gboolean lutil_page_links(gpointer q, const gchar *url, GSList **links)
+{
+  struct _page_s p;
+  gboolean r;
+  CURLcode rc;
+  glong code;
+
+  p.c = lutil_curl_handle_from(q);
+  p.data = g_string_new(NULL);
+
+  curl_easy_setopt(p.c, CURLOPT_URL, url);
+  if (links == NULL)
+    curl_easy_setopt(p.c, CURLOPT_NOBODY, 1L);
+  else
+    {
+      curl_easy_setopt(p.c, CURLOPT_WRITEFUNCTION, _write_cb);
+      curl_easy_setopt(p.c, CURLOPT_WRITEDATA, &p);
+    }
+
+  rc = curl_easy_perform(p.c);
+  lutil_curl_share_account(p.c);
+
+  code = 0;
+  curl_easy_getinfo(p.c, CURLINFO_RESPONSE_CODE, &code);
+
+  /* A truncated page (see PAGE_MAX_BYTES) is still parsed. */
+  r = ((rc == CURLE_OK || rc == CURLE_WRITE_ERROR)
+       && code <400 && _is_html(p.c) == TRUE)
+      ? TRUE
+      : FALSE;
+
+  if (r == TRUE && links != NULL)
+    {
+      gchar *eu = NULL;
+      curl_easy_getinfo(p.c, CURLINFO_EFFECTIVE_URL, &eu);
+      *links = _extract((eu != NULL) ? eu:url, p.data->str);
+    }
+
+  _reset_curl(p.c);
+  g_string_free(p.data, TRUE);
+
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
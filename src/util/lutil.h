@@ -28,6 +28,7 @@ typedef void (*lutil_cb_printerr)(const gchar*, ...);
 /* extern */
 
 extern const gchar *lutil_verbosity_possible_values[];
+extern const gchar *lutil_http_version_possible_values[];
 
 /* regex op */
 
@@ -55,6 +56,7 @@ gchar *lutil_regex_op_apply(lutil_regex_op_t, const gchar*);
 struct lutil_exec_opts_s
 {
   lutil_cb_printerr xperr;
+  const gchar *checksum;
   const gchar *exec_arg;
   const gchar *file_ext;
   const gchar *fpath;
@@ -102,6 +104,7 @@ struct lutil_xchg_seq_opts_s
 {
   const gchar **output_regex;
   lutil_cb_printerr xperr;
+  const gchar *checksum;
   const gchar *file_ext;
   const gchar *fpath;
   gpointer qm;
@@ -164,6 +167,7 @@ struct lutil_query_properties_s
   lutil_query_properties_activity_cb activity;
   lutil_cb_printerr xperr; /* exported {json,xml,...} messages */
   lutil_cb_printerr perr; /* status update messages */
+  gpointer stream_policy; /* lutil_policy_t, or NULL */
   gint exit_status;
   const gchar *url;
   gpointer q;
@@ -177,8 +181,16 @@ void lutil_query_media(gpointer, gpointer);
 
 /* build fpath */
 
+typedef enum
+{
+  UTIL_OUTPUT_SHARD_NONE,
+  UTIL_OUTPUT_SHARD_HASH,
+  UTIL_OUTPUT_SHARD_PREFIX
+} lutilOutputShard;
+
 struct lutil_build_fpath_s
 {
+  lutilOutputShard output_shard;
   lutil_cb_printerr xperr;
   const gchar *file_ext;
   gchar **output_regex;
@@ -211,12 +223,99 @@ struct lutil_file_open_s
 typedef struct lutil_file_open_s *lutil_file_open_t;
 
 gint lutil_file_open(lutil_file_open_t);
+gint lutil_file_preallocate(lutil_file_open_t, const gdouble);
+gint lutil_file_chk_space(const gchar*, const gdouble, const gdouble,
+                          const lutil_cb_printerr);
+
+/* iow */
+
+typedef enum
+{
+  UTIL_PAGE_CACHE_KEEP,
+  UTIL_PAGE_CACHE_DONTNEED,
+  UTIL_PAGE_CACHE_DIRECT
+} lutilPageCache;
+
+struct lutil_iow_stats_s
+{
+  gdouble stall_time; /* seconds paused for the buffer to drain */
+  gdouble fill_mean; /* bytes */
+  gsize fill_peak;
+  gsize size; /* 0 if not buffered */
+  guint stalls;
+};
+
+typedef struct lutil_iow_stats_s *lutil_iow_stats_t;
+typedef struct lutil_iow_s *lutil_iow_t;
+
+lutil_iow_t lutil_iow_new(gpointer, const lutilPageCache, const gsize);
+gint lutil_iow_write(lutil_iow_t, gconstpointer, const gsize);
+gboolean lutil_iow_ready(lutil_iow_t, const gsize);
+gboolean lutil_iow_resume(lutil_iow_t);
+void lutil_iow_stats(const lutil_iow_t, lutil_iow_stats_t);
+gint lutil_iow_free(lutil_iow_t);
+
+/* ring */
+
+typedef struct lutil_ring_s *lutil_ring_t;
+
+lutil_ring_t lutil_ring_new(const gsize);
+gsize lutil_ring_size(const lutil_ring_t);
+gsize lutil_ring_fill(const lutil_ring_t);
+gsize lutil_ring_push(lutil_ring_t, gconstpointer, gsize);
+gsize lutil_ring_peek(const lutil_ring_t, gconstpointer*);
+void lutil_ring_consume(lutil_ring_t, const gsize);
+void lutil_ring_free(lutil_ring_t);
+
+/* sha256 */
+
+struct lutil_sha256_s
+{
+  guint32 h[8];
+  guint64 n;
+  guchar buf[64];
+};
+
+typedef struct lutil_sha256_s *lutil_sha256_t;
+
+void lutil_sha256_init(lutil_sha256_t);
+void lutil_sha256_update(lutil_sha256_t, gconstpointer, gsize);
+gchar *lutil_sha256_hex(const lutil_sha256_t);
+gchar *lutil_sha256_state_to_str(const lutil_sha256_t);
+gboolean lutil_sha256_state_from_str(lutil_sha256_t, const gchar*);
+gint lutil_sha256_manifest_append(const gchar*, const gchar*, const gchar*,
+                                  const lutil_cb_printerr);
+
+/* sidecar */
+
+struct lutil_sidecar_s
+{
+  gdouble content_bytes;
+  gchar *last_modified;
+  gboolean complete;
+  guint32 adler32; /* of the first 'bytes' of the file */
+  gchar *sha256; /* lutil_sha256_state_to_str, or NULL */
+  gdouble bytes;
+  gchar *etag;
+};
+
+typedef struct lutil_sidecar_s *lutil_sidecar_t;
+
+guint32 lutil_adler32(const guint32, gconstpointer, gsize);
+
+gint lutil_sidecar_read(const gchar*, lutil_sidecar_t);
+gint lutil_sidecar_write(const gchar*, const lutil_sidecar_t,
+                         const lutil_cb_printerr);
+gint lutil_sidecar_verify(const gchar*, const lutil_sidecar_t, guint32*,
+                          gdouble*, lutil_sha256_t);
+void lutil_sidecar_clear(lutil_sidecar_t);
 
 /* curl */
 
 struct lutil_net_opts_s
 {
-  gdouble throttle_ki_s;
+  const gchar *http_version;
+  gdouble throttle_ki_s; /* the transfers use lutil_ratelimit */
   gint verbose;
 };
 
@@ -224,6 +323,77 @@ typedef struct lutil_net_opts_s *lutil_net_opts_t;
 
 gpointer lutil_curl_handle_from(gpointer);
 
+void lutil_curl_share_attach(gpointer);
+void lutil_curl_share_account(gpointer);
+void lutil_curl_share_free();
+
+/* stats */
+
+struct lutil_curl_stats_s
+{
+  gdouble starttransfer_time;
+  gdouble appconnect_time;
+  gdouble namelookup_time;
+  gdouble speed_download;
+  gdouble connect_time;
+  gdouble size_download;
+  gdouble total_time;
+  glong redirect_count;
+  glong response_code;
+  glong http_version; /* CURL_HTTP_VERSION_*, 0 if unknown */
+  const gchar *url; /* effective URL, owned by libcurl */
+};
+
+typedef struct lutil_curl_stats_s *lutil_curl_stats_t;
+
+void lutil_curl_stats_from(gpointer, lutil_curl_stats_t);
+const gchar *lutil_curl_http_version_str(const glong);
+
+gint lutil_stats_write(const gchar*, const gchar*, const gchar*,
+                       const lutil_curl_stats_t, const lutil_iow_stats_t,
+                       const lutil_cb_printerr);
+
+/* metrics */
+
+typedef enum
+{
+  UTIL_METRIC_URLS_PROCESSED,
+  UTIL_METRIC_URLS_FAILED,
+  UTIL_METRIC_URLS_SKIPPED,
+  UTIL_METRIC_TRANSFER_BYTES,
+  UTIL_METRIC_RESOLVE_SECONDS,
+  UTIL_METRIC_METAINFO_SECONDS,
+  UTIL_METRIC_TRANSFER_SECONDS,
+  UTIL_METRIC_TRANSFER_BYTES_PER_SECOND
+} lutilMetric;
+
+gint lutil_metrics_init(const gchar*, const guint, const lutil_cb_printerr);
+void lutil_metrics_add(const lutilMetric, const gchar*, const gdouble);
+void lutil_metrics_close();
+
+/* index */
+
+gint lutil_index_init(const gchar*, const lutil_cb_printerr);
+gboolean lutil_index_enabled();
+gchar *lutil_index_lookup(const gchar*, const gchar*, const gchar*);
+gint lutil_index_add(const gchar*, const gchar*, const gchar*,
+                     const gchar*);
+void lutil_index_close();
+
+/* ratelimit */
+
+gint lutil_ratelimit_init(const gint, const gchar*, const gchar*,
+                          const lutil_cb_printerr);
+void lutil_ratelimit_consume(const gsize);
+void lutil_ratelimit_close();
+
+/* trace */
+
+gint lutil_trace_init(const gchar*, const lutil_cb_printerr);
+void lutil_trace_begin(const gchar*, const gchar*, const gchar*);
+void lutil_trace_end(const gchar*, const gchar*);
+void lutil_trace_close();
+
 /* verbosity */
 
 typedef enum
@@ -248,6 +418,10 @@ gint lutil_choose_subtitle(const gpointer, const gpointer, const gchar*,
                            const lutil_cb_printerr, gpointer*,
                            const gboolean);
 
+gint lutil_choose_subtitles(const gpointer, const gpointer, const gchar*,
+                            const lutil_cb_printerr, GSList**,
+                            const gboolean);
+
 gint lutil_query_metainfo(gpointer, gpointer, gpointer*, lutil_cb_printerr);
 
 GSList *lutil_slist_prepend_if_unique(GSList*, const gchar*);
@@ -259,6 +433,82 @@ gchar *lutil_strerror();
 gint lutil_quvi_init(gpointer*, lutil_net_opts_t o);
 gint lutil_parse_input(gpointer, const gchar**);
 
+/* quvi handle pool */
+
+typedef gint (*lutil_cb_quvi_init)(gpointer*);
+
+struct lutil_quvi_pool_s
+{
+  GAsyncQueue *queue;
+  guint n;
+};
+
+typedef struct lutil_quvi_pool_s *lutil_quvi_pool_t;
+
+lutil_quvi_pool_t lutil_quvi_pool_new(const guint, lutil_cb_quvi_init);
+void lutil_quvi_pool_push(lutil_quvi_pool_t, gpointer);
+gpointer lutil_quvi_pool_pop(lutil_quvi_pool_t);
+void lutil_quvi_pool_free(lutil_quvi_pool_t);
+
+/* stream policy */
+
+typedef struct lutil_policy_s *lutil_policy_t;
+
+lutil_policy_t lutil_policy_new(const gchar*, const lutil_cb_quvi_init,
+                                const lutil_cb_printerr);
+gint lutil_policy_choose(const lutil_policy_t, const gpointer,
+                         const gpointer, const lutil_cb_printerr);
+void lutil_policy_free(lutil_policy_t);
+
+/* resolve ahead */
+
+/* Called in a worker thread: quvi_t, URL, userdata. */
+typedef gpointer (*lutil_resolve_ahead_cb_resolve)(gpointer, const gchar*,
+    gpointer);
+typedef void (*lutil_resolve_ahead_cb_free)(gpointer);
+
+/* Called in the input order: quvi_t, resolved object, URL, errmsg. */
+typedef gint (*lutil_resolve_ahead_cb_consume)(gpointer, gpointer,
+    const gchar*, const gchar*, gpointer);
+
+struct lutil_resolve_ahead_s
+{
+  lutil_resolve_ahead_cb_consume consume;
+  lutil_resolve_ahead_cb_resolve resolve; /* e.g. quvi_media_new */
+  lutil_resolve_ahead_cb_free free; /* e.g. quvi_media_free */
+  lutil_cb_quvi_init quvi_init;
+  lutil_cb_printerr xperr;
+  gpointer userdata;
+  guint window;
+};
+
+typedef struct lutil_resolve_ahead_s *lutil_resolve_ahead_t;
+
+gint lutil_resolve_ahead(lutil_resolve_ahead_t, const GSList*);
+
+/* bloom filter */
+
+struct lutil_bloom_s
+{
+  guint64 nbits;
+  guchar *bits;
+  guint k;
+};
+
+typedef struct lutil_bloom_s *lutil_bloom_t;
+
+lutil_bloom_t lutil_bloom_new(const guint, const gdouble);
+gboolean lutil_bloom_test_and_add(lutil_bloom_t, const gchar*);
+void lutil_bloom_free(lutil_bloom_t);
+
+/* url */
+
+gchar *lutil_url_resolve(const gchar*, const gchar*);
+gchar *lutil_url_host(const gchar*);
+gchar *lutil_url_site(const gchar*);
+
+gboolean lutil_page_links(gpointer, const gchar*, GSList**);
+
 #endif /* lutil_h */
 
 /* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -34,6 +34,7 @@ gint lutil_query_metainfo(quvi_t q, quvi_media_t qm,
                           lutil_cb_printerr xperr)
 {
   gchar *m_url;
+  GTimer *t;
   gint r;
 
   g_assert(xperr != NULL);
@@ -48,7 +49,13 @@ gint lutil_query_metainfo(quvi_t q, quvi_media_t qm,
   if (r != EXIT_SUCCESS)
     return (EXIT_FAILURE);
 
+  t = g_timer_new();
   *qmi = quvi_http_metainfo_new(q, m_url);
+
+  lutil_metrics_add(UTIL_METRIC_METAINFO_SECONDS, m_url,
+                    g_timer_elapsed(t, NULL));
+  g_timer_destroy(t);
+
   if (quvi_ok(q) == QUVI_FALSE)
     {
       xperr(_("libquvi: while querying content meta-info: %s"),
@@ -0,0 +1,365 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * An OpenMetrics textfile exporter, e.g. for the textfile collector of
+ * the Prometheus node_exporter. The metrics are kept in memory, labelled
+ * by the domain of the URL, and written to the file periodically, and
+ * once more when closed. The file is replaced atomically.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+typedef enum {METRIC_COUNTER, METRIC_HISTOGRAM} MetricType;
+
+static const gdouble latency_buckets[] =
+  {.05, .1, .25, .5, 1, 2.5, 5, 10, 30, 60, -1};
+
+static const gdouble duration_buckets[] =
+  {1, 5, 10, 30, 60, 300, 900, 1800, 3600, -1};
+
+static const gdouble throughput_buckets[] =
+  {65536, 262144, 1048576, 4194304, 16777216, 67108864, -1};
+
+struct metric_s
+{
+  const gchar *name;
+  const gchar *help;
+  const gchar *unit;
+  MetricType type;
+  const gdouble *buckets;
+};
+
+/* In the order of lutilMetric. */
+static const struct metric_s metrics[] =
+{
+  {"quvi_urls_processed", "URLs processed", NULL, METRIC_COUNTER, NULL},
+  {"quvi_urls_failed", "URLs that failed", NULL, METRIC_COUNTER, NULL},
+  {"quvi_urls_skipped", "URLs skipped (retrieved already or forced)",
+   NULL, METRIC_COUNTER, NULL},
+  {"quvi_transfer_bytes", "Bytes transferred", "bytes", METRIC_COUNTER,
+   NULL},
+  {"quvi_resolve_seconds", "Media property resolve latency", "seconds",
+   METRIC_HISTOGRAM, latency_buckets},
+  {"quvi_metainfo_seconds", "HTTP metainfo query latency", "seconds",
+   METRIC_HISTOGRAM, latency_buckets},
+  {"quvi_transfer_seconds", "Media transfer duration", "seconds",
+   METRIC_HISTOGRAM, duration_buckets},
+  {"quvi_transfer_bytes_per_second", "Media transfer throughput", NULL,
+   METRIC_HISTOGRAM, throughput_buckets},
+};
+
+#define N_METRICS G_N_ELEMENTS(metrics)
+
+struct series_s
+{
+  guint64 *buckets; /* histogram: cumulative counts, one per bucket */
+  guint64 count;
+  gdouble value; /* counter: the total, histogram: the sum */
+};
+
+typedef struct series_s *series_t;
+
+static struct
+{
+  GHashTable *series[N_METRICS]; /* domain -> series_t */
+  lutil_cb_printerr xperr;
+  GThread *thread;
+  gboolean stop;
+  guint interval;
+  gchar *fpath;
+  GMutex lock;
+  GCond cond;
+} m;
+
+static void _series_free(gpointer p)
+{
+  series_t s = (series_t) p;
+  g_free(s->buckets);
+  g_free(s);
+}
+
+static guint _n_buckets(const gdouble *b)
+{
+  guint n = 0;
+  while (b[n] >=0)
+    ++n;
+  return (n);
+}
+
+static gchar *_domain_from(const gchar *url)
+{
+  gchar *r, *p;
+
+  r = (url != NULL) ? lutil_url_host(url) : NULL;
+  if (r == NULL)
+    return (g_strdup("unknown"));
+
+  p = strrchr(r, ':'); /* Drop the port. */
+  if (p != NULL && strchr(r, ']') == NULL)
+    *p = '\0';
+
+  return (r);
+}
+
+/* Add to a counter, or observe a value in a histogram. */
+void lutil_metrics_add(const lutilMetric i, const gchar *url,
+                       const gdouble v)
+{
+  const struct metric_s *d;
+  series_t s;
+  gchar *k;
+
+  if (m.fpath == NULL)
+    return;
+
+  g_assert(i < N_METRICS);
+
+  d = &metrics[i];
+  k = _domain_from(url);
+
+  g_mutex_lock(&m.lock);
+
+  s = g_hash_table_lookup(m.series[i], k);
+  if (s == NULL)
+    {
+      s = g_new0(struct series_s, 1);
+      if (d->type == METRIC_HISTOGRAM)
+        s->buckets = g_new0(guint64, _n_buckets(d->buckets));
+      g_hash_table_insert(m.series[i], k, s);
+    }
+  else
+    g_free(k);
+
+  s->value += v;
+  ++s->count;
+
+  if (d->type == METRIC_HISTOGRAM)
+    {
+      guint j;
+      for (j=0; d->buckets[j] >=0; ++j)
+        {
+          if (v <= d->buckets[j])
+            ++s->buckets[j];
+        }
+    }
+
+  g_mutex_unlock(&m.lock);
+}
+
+/* Not the locale decimal point, not rounded either, e.g. 1048576. */
+static const gchar *_dtostr(gchar *buf, const gdouble d)
+{
+  return (g_ascii_dtostr(buf, G_ASCII_DTOSTR_BUF_SIZE, d));
+}
+
+static void _format_series(GString *b, const struct metric_s *d,
+                           const gchar *domain, const series_t s)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+  guint j;
+
+  if (d->type == METRIC_COUNTER)
+    {
+      g_string_append_printf(b, "%s_total{domain=\"%s\"} %s\n",
+                             d->name, domain, _dtostr(buf, s->value));
+      return;
+    }
+
+  for (j=0; d->buckets[j] >=0; ++j)
+    {
+      g_string_append_printf(b,
+                             "%s_bucket{domain=\"%s\",le=\"%s\"} %"
+                             G_GUINT64_FORMAT"\n",
+                             d->name, domain,
+                             _dtostr(buf, d->buckets[j]),
+                             s->buckets[j]);
+    }
+
+  g_string_append_printf(b, "%s_bucket{domain=\"%s\",le=\"+Inf\"} %"
+                         G_GUINT64_FORMAT"\n", d->name, domain, s->count);
+
+  g_string_append_printf(b, "%s_sum{domain=\"%s\"} %s\n",
+                         d->name, domain, _dtostr(buf, s->value));
+
+  g_string_append_printf(b, "%s_count{domain=\"%s\"} %"
+                         G_GUINT64_FORMAT"\n", d->name, domain, s->count);
+}
+
+/* Return the metrics in the OpenMetrics text format. Locked. */
+static gchar *_format()
+{
+  GList *keys, *curr;
+  GString *b;
+  guint i;
+
+  b = g_string_new(NULL);
+
+  for (i=0; i<N_METRICS; ++i)
+    {
+      const struct metric_s *d = &metrics[i];
+
+      g_string_append_printf(b, "# TYPE %s %s\n", d->name,
+                             (d->type == METRIC_COUNTER)
+                             ? "counter"
+                             : "histogram");
+
+      if (d->unit != NULL)
+        g_string_append_printf(b, "# UNIT %s %s\n", d->name, d->unit);
+
+      g_string_append_printf(b, "# HELP %s %s.\n", d->name, d->help);
+
+      keys = g_list_sort(g_hash_table_get_keys(m.series[i]),
+                         (GCompareFunc) g_strcmp0);
+
+      for (curr=keys; curr != NULL; curr=g_list_next(curr))
+        {
+          _format_series(b, d, curr->data,
+                         g_hash_table_lookup(m.series[i], curr->data));
+        }
+      g_list_free(keys);
+    }
+  g_string_append(b, "# EOF\n");
+
+  return (g_string_free(b, FALSE));
+}
+
+/* Write the metrics to the file. Called with the lock held. */
+static void _write()
+{
+  GError *e;
+  gchar *s;
+
+  s = _format();
+  e = NULL;
+
+  g_mutex_unlock(&m.lock);
+
+  /* Writes to a temporary file first, then renames it. */
+  if (g_file_set_contents(m.fpath, s, -1, &e) == FALSE)
+    {
+      m.xperr(_("while writing: %s: %s"), m.fpath, e->message);
+      g_error_free(e);
+    }
+  g_free(s);
+
+  g_mutex_lock(&m.lock);
+}
+
+static gpointer _writer(gpointer p)
+{
+  g_mutex_lock(&m.lock);
+  while (m.stop == FALSE)
+    {
+      const gint64 t =
+        g_get_monotonic_time() + m.interval * G_TIME_SPAN_SECOND;
+
+      while (m.stop == FALSE && g_cond_wait_until(&m.cond, &m.lock, t))
+        ; /* Woken up before the time, but not stopped. */
+
+      if (m.stop == FALSE)
+        _write();
+    }
+  g_mutex_unlock(&m.lock);
+  return (NULL);
+}
+
+/*
+ * Start collecting the metrics. Write them to fpath every interval
+ * seconds, if the interval is >0, and when lutil_metrics_close is
+ * called.
+ */
+gint lutil_metrics_init(const gchar *fpath, const guint interval,
+                        const lutil_cb_printerr xperr)
+{
+  guint i;
+
+  g_assert(m.fpath == NULL);
+  g_assert(fpath != NULL);
+  g_assert(xperr != NULL);
+
+  for (i=0; i<N_METRICS; ++i)
+    {
+      m.series[i] =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _series_free);
+    }
+
+  g_mutex_init(&m.lock);
+  g_cond_init(&m.cond);
+
+  m.fpath = g_strdup(fpath);
+  m.interval = interval;
+  m.xperr = xperr;
+  m.stop = FALSE;
+
+  if (interval >0)
+    {
+      GError *e = NULL;
+
+      m.thread = g_thread_try_new("metrics", _writer, NULL, &e);
+      if (m.thread == NULL)
+        {
+          xperr(_("while creating thread: %s"), e->message);
+          g_error_free(e);
+          lutil_metrics_close();
+          return (EXIT_FAILURE);
+        }
+    }
+  return (EXIT_SUCCESS);
+}
+
+/* Stop the writer, write the metrics one last time. */
+void lutil_metrics_close()
+{
+  guint i;
+
+  if (m.fpath == NULL)
+    return;
+
+  g_mutex_lock(&m.lock);
+  m.stop = TRUE;
+  g_cond_signal(&m.cond);
+  g_mutex_unlock(&m.lock);
+
+  if (m.thread != NULL)
+    g_thread_join(m.thread);
+
+  g_mutex_lock(&m.lock);
+  _write();
+  g_mutex_unlock(&m.lock);
+
+  for (i=0; i<N_METRICS; ++i)
+    g_hash_table_destroy(m.series[i]);
+
+  g_mutex_clear(&m.lock);
+  g_cond_clear(&m.cond);
+
+  g_free(m.fpath);
+  memset(&m, 0, sizeof(m));
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -0,0 +1,565 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Stream selection policy. The policy is a comma-separated list of
+ * terms, evaluated over the streams of the media:
+ *
+ *   FIELD OP VALUE  constraint, OP is one of = != ~ (regex) < <= > >=
+ *   min:FIELD       preference, the smallest value first
+ *   max:FIELD       preference, the largest value first
+ *
+ * The preferences are applied in the order given, the first stream
+ * wins a tie. e.g. "height>=720,container=mp4,min:size". If the policy
+ * refers to "size", the content length of each of the acceptable
+ * streams is queried concurrently (HTTP HEAD).
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <quvi.h>
+
+#include "lutil.h"
+
+typedef enum
+{
+  FIELD_ID,
+  FIELD_CONTAINER,
+  FIELD_VIDEO_ENCODING,
+  FIELD_AUDIO_ENCODING,
+  _FIELD_LAST_STR = FIELD_AUDIO_ENCODING,
+  FIELD_HEIGHT,
+  FIELD_WIDTH,
+  FIELD_VIDEO_BITRATE,
+  FIELD_AUDIO_BITRATE,
+  FIELD_BITRATE,
+  FIELD_SIZE,
+  _FIELD_COUNT
+} PolicyField;
+
+static const gchar *field_names[] =
+{
+  "id", "container", "vencoding", "aencoding", "height", "width",
+  "vbitrate", "abitrate", "bitrate", "size", NULL
+};
+
+typedef enum
+{
+  OP_EQ, OP_NE, OP_MATCH, OP_LT, OP_LE, OP_GT, OP_GE, OP_MIN, OP_MAX
+} PolicyOp;
+
+/* The longer operators first, "<" would match "<=". */
+static const struct
+{
+  const gchar *s;
+  PolicyOp op;
+} ops[] =
+{
+  {"!=", OP_NE}, {"<=", OP_LE}, {">=", OP_GE}, {"=", OP_EQ},
+  {"~", OP_MATCH}, {"<", OP_LT}, {">", OP_GT}, {NULL, 0}
+};
+
+struct term_s
+{
+  PolicyField field;
+  PolicyOp op;
+  GRegex *re;
+  gchar *s;
+  gdouble n;
+};
+
+typedef struct term_s *term_t;
+
+struct lutil_policy_s
+{
+  lutil_cb_quvi_init quvi_init;
+  lutil_quvi_pool_t pool;
+  GSList *constraints;
+  GSList *preferences;
+  gboolean needs_size;
+};
+
+struct candidate_s
+{
+  gdouble n[_FIELD_COUNT];
+  gchar *s[_FIELD_LAST_STR+1];
+  gchar *url;
+  guint index;
+};
+
+typedef struct candidate_s *candidate_t;
+
+static void _term_free(term_t t)
+{
+  if (t == NULL)
+    return;
+
+  if (t->re != NULL)
+    g_regex_unref(t->re);
+
+  g_free(t->s);
+  g_free(t);
+}
+
+static gint _field_from(const gchar *s, const gsize n)
+{
+  gint i;
+  for (i=0; field_names[i] != NULL; ++i)
+    {
+      if (strlen(field_names[i]) == n && strncmp(field_names[i], s, n) ==0)
+        return (i);
+    }
+  return (-1);
+}
+
+/* Parse a number with an optional binary suffix (k, M, G). */
+static gboolean _parse_number(const gchar *s, gdouble *n)
+{
+  gchar *e;
+
+  *n = g_ascii_strtod(s, &e);
+  if (e == s)
+    return (FALSE);
+
+  switch (g_ascii_tolower(*e))
+    {
+    case 'g':
+      *n *= 1024;
+      /* fall through */
+    case 'm':
+      *n *= 1024;
+      /* fall through */
+    case 'k':
+      *n *= 1024;
+      ++e;
+    default:
+      break;
+    }
+  return ((*e == '\0') ? TRUE:FALSE);
+}
+
+static term_t _parse_term(const gchar *s, const lutil_cb_printerr xperr)
+{
+  gsize n;
+  term_t t;
+  gint f, i;
+
+  t = g_new0(struct term_s, 1);
+
+  if (g_str_has_prefix(s, "min:") || g_str_has_prefix(s, "max:"))
+    {
+      t->op = (s[1] == 'i') ? OP_MIN:OP_MAX;
+      s += 4;
+      n = strlen(s);
+    }
+  else
+    {
+      n = strcspn(s, "!=~<>");
+      for (i=0; ops[i].s != NULL; ++i)
+        {
+          if (g_str_has_prefix(s+n, ops[i].s))
+            break;
+        }
+      if (ops[i].s == NULL)
+        {
+          xperr(_("invalid stream policy term: `%s'"), s);
+          goto fail;
+        }
+      t->op = ops[i].op;
+      t->s = g_strdup(s + n + strlen(ops[i].s));
+      g_strstrip(t->s);
+    }
+
+  f = _field_from(s, n);
+  if (f <0)
+    {
+      xperr(_("invalid stream policy field in `%s'"), s);
+      goto fail;
+    }
+  t->field = f;
+
+  if (t->field <= _FIELD_LAST_STR)
+    {
+      if (t->op != OP_EQ && t->op != OP_NE && t->op != OP_MATCH)
+        {
+          xperr(_("stream policy field `%s' is not a number"),
+                field_names[f]);
+          goto fail;
+        }
+      if (t->op == OP_MATCH)
+        {
+          GError *e = NULL;
+
+          t->re = g_regex_new(t->s, G_REGEX_CASELESS, 0, &e);
+          if (e != NULL)
+            {
+              xperr(_("while compiling stream policy regex: %s"),
+                    e->message);
+              g_error_free(e);
+              goto fail;
+            }
+        }
+    }
+  else if (t->op == OP_MATCH
+           || (t->s != NULL && _parse_number(t->s, &t->n) == FALSE))
+    {
+      xperr(_("invalid stream policy term: `%s'"), s);
+      goto fail;
+    }
+  return (t);
+
+fail:
+  _term_free(t);
+  return (NULL);
+}
+
+void lutil_policy_free(lutil_policy_t p)
+{
+  if (p == NULL)
+    return;
+
+  if (p->pool != NULL)
+    lutil_quvi_pool_free(p->pool);
+
+  lutil_slist_free_full(p->constraints, (GFunc) _term_free);
+  lutil_slist_free_full(p->preferences, (GFunc) _term_free);
+
+  g_free(p);
+}
+
+/*
+ * Parse the policy. The quvi_init is used to create the handles for
+ * the concurrent HTTP HEAD requests, if the policy needs the sizes.
+ */
+lutil_policy_t lutil_policy_new(const gchar *s,
+                                const lutil_cb_quvi_init quvi_init,
+                                const lutil_cb_printerr xperr)
+{
+  lutil_policy_t p;
+  gchar **v;
+  gint i;
+
+  g_assert(xperr != NULL);
+  g_assert(s != NULL);
+
+  p = g_new0(struct lutil_policy_s, 1);
+  p->quvi_init = quvi_init;
+
+  v = g_strsplit(s, ",", 0);
+  for (i=0; v[i] != NULL; ++i)
+    {
+      term_t t;
+
+      if (strlen(g_strstrip(v[i])) ==0)
+        continue;
+
+      t = _parse_term(v[i], xperr);
+      if (t == NULL)
+        {
+          lutil_policy_free(p);
+          g_strfreev(v);
+          return (NULL);
+        }
+
+      if (t->field == FIELD_SIZE)
+        p->needs_size = TRUE;
+
+      if (t->op == OP_MIN || t->op == OP_MAX)
+        p->preferences = g_slist_append(p->preferences, t);
+      else
+        p->constraints = g_slist_append(p->constraints, t);
+    }
+  g_strfreev(v);
+  return (p);
+}
+
+static void _candidate_free(candidate_t c)
+{
+  gint i;
+  for (i=0; i <= _FIELD_LAST_STR; ++i)
+    g_free(c->s[i]);
+  g_free(c->url);
+  g_free(c);
+}
+
+static gchar *_dup_str(const quvi_media_t qm, const QuviMediaProperty n)
+{
+  gchar *s = NULL;
+  quvi_media_get(qm, n, &s);
+  return (g_strdup(s));
+}
+
+static gdouble _get_number(const quvi_media_t qm, const QuviMediaProperty n)
+{
+  gdouble d = 0;
+  quvi_media_get(qm, n, &d);
+  return (d);
+}
+
+static candidate_t _candidate_new(const quvi_media_t qm, const guint i)
+{
+  candidate_t c = g_new0(struct candidate_s, 1);
+
+  c->s[FIELD_ID] = _dup_str(qm, QUVI_MEDIA_STREAM_PROPERTY_ID);
+  c->s[FIELD_CONTAINER] =
+    _dup_str(qm, QUVI_MEDIA_STREAM_PROPERTY_CONTAINER);
+  c->s[FIELD_VIDEO_ENCODING] =
+    _dup_str(qm, QUVI_MEDIA_STREAM_PROPERTY_VIDEO_ENCODING);
+  c->s[FIELD_AUDIO_ENCODING] =
+    _dup_str(qm, QUVI_MEDIA_STREAM_PROPERTY_AUDIO_ENCODING);
+
+  c->n[FIELD_HEIGHT] =
+    _get_number(qm, QUVI_MEDIA_STREAM_PROPERTY_VIDEO_HEIGHT);
+  c->n[FIELD_WIDTH] =
+    _get_number(qm, QUVI_MEDIA_STREAM_PROPERTY_VIDEO_WIDTH);
+  c->n[FIELD_VIDEO_BITRATE] =
+    _get_number(qm, QUVI_MEDIA_STREAM_PROPERTY_VIDEO_BITRATE_KBIT_S);
+  c->n[FIELD_AUDIO_BITRATE] =
+    _get_number(qm, QUVI_MEDIA_STREAM_PROPERTY_AUDIO_BITRATE_KBIT_S);
+  c->n[FIELD_BITRATE] = c->n[FIELD_VIDEO_BITRATE]
+                        + c->n[FIELD_AUDIO_BITRATE];
+
+  c->url = _dup_str(qm, QUVI_MEDIA_STREAM_PROPERTY_URL);
+  c->index = i;
+
+  return (c);
+}
+
+/* A numeric constraint fails if the value was not reported (0). */
+static gboolean _term_accepts(const term_t t, const candidate_t c)
+{
+  if (t->field <= _FIELD_LAST_STR)
+    {
+      const gchar *s = (c->s[t->field] != NULL) ? c->s[t->field] : "";
+      switch (t->op)
+        {
+        case OP_EQ:
+          return ((g_ascii_strcasecmp(s, t->s) ==0) ? TRUE:FALSE);
+        case OP_NE:
+          return ((g_ascii_strcasecmp(s, t->s) !=0) ? TRUE:FALSE);
+        default:
+          return (g_regex_match(t->re, s, 0, NULL));
+        }
+    }
+  else
+    {
+      const gdouble n = c->n[t->field];
+
+      if (n <= 0)
+        return (FALSE);
+
+      switch (t->op)
+        {
+        case OP_EQ:
+          return ((n == t->n) ? TRUE:FALSE);
+        case OP_NE:
+          return ((n != t->n) ? TRUE:FALSE);
+        case OP_LT:
+          return ((n < t->n) ? TRUE:FALSE);
+        case OP_LE:
+          return ((n <= t->n) ? TRUE:FALSE);
+        case OP_GT:
+          return ((n > t->n) ? TRUE:FALSE);
+        default:
+          return ((n >= t->n) ? TRUE:FALSE);
+        }
+    }
+}
+
+/* The size is known only after the query, skip it if !sized. */
+static gboolean _accepts(const GSList *l, const candidate_t c,
+                         const gboolean sized)
+{
+  for (; l != NULL; l=g_slist_next(l))
+    {
+      const term_t t = (const term_t) l->data;
+
+      if (t->field == FIELD_SIZE && sized == FALSE)
+        continue;
+
+      if (_term_accepts(t, c) == FALSE)
+        return (FALSE);
+    }
+  return (TRUE);
+}
+
+/* The streams with an unknown (0) value are the least preferred. */
+static gint _compare(gconstpointer a, gconstpointer b, gpointer userdata)
+{
+  const candidate_t ca = *(const candidate_t*) a;
+  const candidate_t cb = *(const candidate_t*) b;
+  const GSList *l;
+
+  for (l=(const GSList*) userdata; l != NULL; l=g_slist_next(l))
+    {
+      const term_t t = (const term_t) l->data;
+      const gdouble na = ca->n[t->field];
+      const gdouble nb = cb->n[t->field];
+
+      if (na == nb)
+        continue;
+
+      if (na <= 0 || nb <= 0)
+        return ((na <= 0) ? 1:-1);
+
+      if (t->op == OP_MIN)
+        return ((na < nb) ? -1:1);
+      else
+        return ((na > nb) ? -1:1);
+    }
+  return ((ca->index < cb->index) ? -1:1);
+}
+
+static void _probe(gpointer data, gpointer userdata)
+{
+  quvi_http_metainfo_t qmi;
+  lutil_policy_t p;
+  candidate_t c;
+  quvi_t q;
+
+  p = (lutil_policy_t) userdata;
+  c = (candidate_t) data;
+
+  q = lutil_quvi_pool_pop(p->pool);
+
+  lutil_trace_begin("quvi", "probe", c->url);
+  qmi = quvi_http_metainfo_new(q, c->url);
+  lutil_trace_end("quvi", "probe");
+
+  if (quvi_ok(q) == QUVI_TRUE)
+    {
+      quvi_http_metainfo_get(qmi, QUVI_HTTP_METAINFO_PROPERTY_LENGTH_BYTES,
+                             &c->n[FIELD_SIZE]);
+    }
+  quvi_http_metainfo_free(qmi);
+
+  lutil_quvi_pool_push(p->pool, q);
+}
+
+#define PROBE_MAX_THREADS 4
+
+/* Query the content length of the candidates concurrently. */
+static gint _probe_sizes(lutil_policy_t p, GPtrArray *v,
+                         const lutil_cb_printerr xperr)
+{
+  GThreadPool *tp;
+  guint i;
+
+  if (p->pool == NULL)
+    {
+      if (p->quvi_init == NULL)
+        return (EXIT_SUCCESS);
+
+      p->pool = lutil_quvi_pool_new(PROBE_MAX_THREADS, p->quvi_init);
+      if (p->pool == NULL)
+        {
+          xperr(_("while creating the stream size query handles"));
+          return (EXIT_FAILURE);
+        }
+    }
+
+  tp = g_thread_pool_new(_probe, p, PROBE_MAX_THREADS, FALSE, NULL);
+  if (tp == NULL)
+    {
+      for (i=0; i<v->len; ++i)
+        _probe(g_ptr_array_index(v, i), p);
+      return (EXIT_SUCCESS);
+    }
+
+  for (i=0; i<v->len; ++i)
+    g_thread_pool_push(tp, g_ptr_array_index(v, i), NULL);
+
+  g_thread_pool_free(tp, FALSE, TRUE);
+  return (EXIT_SUCCESS);
+}
+
+/* Make the stream with the ID the current stream of the media. */
+static void _select(const quvi_media_t qm, const gchar *id)
+{
+  while (quvi_media_stream_next(qm) == QUVI_TRUE)
+    {
+      gchar *s = NULL;
+      quvi_media_get(qm, QUVI_MEDIA_STREAM_PROPERTY_ID, &s);
+      if (g_strcmp0(s, id) ==0)
+        break;
+    }
+}
+
+/* Choose the stream of the media according to the policy. */
+gint lutil_policy_choose(const lutil_policy_t p, const gpointer q,
+                         const gpointer qm, const lutil_cb_printerr xperr)
+{
+  candidate_t c;
+  GPtrArray *v;
+  guint i;
+
+  g_assert(xperr != NULL);
+  g_assert(qm != NULL);
+  g_assert(q != NULL);
+  g_assert(p != NULL);
+
+  v = g_ptr_array_new_with_free_func((GDestroyNotify) _candidate_free);
+
+  for (i=0; quvi_media_stream_next(qm) == QUVI_TRUE; ++i)
+    {
+      c = _candidate_new(qm, i);
+      if (_accepts(p->constraints, c, FALSE) == TRUE)
+        g_ptr_array_add(v, c);
+      else
+        _candidate_free(c);
+    }
+
+
+  if (p->needs_size == TRUE && v->len >0)
+    {
+      if (_probe_sizes(p, v, xperr) != EXIT_SUCCESS)
+        {
+          g_ptr_array_free(v, TRUE);
+          return (EXIT_FAILURE);
+        }
+
+      for (i=v->len; i>0; --i)
+        {
+          c = g_ptr_array_index(v, i-1);
+          if (_accepts(p->constraints, c, TRUE) == FALSE)
+            g_ptr_array_remove_index(v, i-1);
+        }
+    }
+
+  if (v->len ==0)
+    {
+      xperr(_("no stream matches the stream policy"));
+      g_ptr_array_free(v, TRUE);
+      return (EXIT_FAILURE);
+    }
+
+  g_ptr_array_sort_with_data(v, _compare, p->preferences);
+
+  c = g_ptr_array_index(v, 0);
+  _select(qm, c->s[FIELD_ID]);
+
+  g_ptr_array_free(v, TRUE);
+  return (EXIT_SUCCESS);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -0,0 +1,94 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A pool of initialized libquvi handles. The handles are created
+ * up-front by the calling thread, and then handed out to the worker
+ * threads one at a time: a libquvi handle must never be used by more
+ * than one thread at the same time.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib/gi18n.h>
+#include <quvi.h>
+
+#include "lutil.h"
+
+lutil_quvi_pool_t lutil_quvi_pool_new(const guint n,
+                                      lutil_cb_quvi_init quvi_init)
+{
+  lutil_quvi_pool_t p;
+  guint i;
+
+  g_assert(quvi_init != NULL);
+  g_assert(n >0);
+
+  p = g_new0(struct lutil_quvi_pool_s, 1);
+  p->queue = g_async_queue_new();
+
+  for (i=0; i<n; ++i)
+    {
+      quvi_t q = NULL;
+
+      if (quvi_init(&q) != EXIT_SUCCESS)
+        {
+          quvi_free(q);
+          lutil_quvi_pool_free(p);
+          return (NULL);
+        }
+      g_async_queue_push(p->queue, q);
+      ++p->n;
+    }
+  return (p);
+}
+
+/* Return the next available handle, block until one is released. */
+gpointer lutil_quvi_pool_pop(lutil_quvi_pool_t p)
+{
+  g_assert(p != NULL);
+  return (g_async_queue_pop(p->queue));
+}
+
+/* Release the handle back to the pool. */
+void lutil_quvi_pool_push(lutil_quvi_pool_t p, gpointer q)
+{
+  g_assert(p != NULL);
+  g_assert(q != NULL);
+  g_async_queue_push(p->queue, q);
+}
+
+/* Wait for all handles to be released, then free them. */
+void lutil_quvi_pool_free(lutil_quvi_pool_t p)
+{
+  if (p == NULL)
+    return;
+
+  while (p->n >0)
+    {
+      quvi_free(g_async_queue_pop(p->queue));
+      --p->n;
+    }
+  g_async_queue_unref(p->queue);
+  g_free(p);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
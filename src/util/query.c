@@ -35,7 +35,9 @@ void lutil_query_playlist(gpointer p, gpointer userdata)
   if (qps->exit_status != EXIT_SUCCESS)
     return;
 
+  lutil_trace_begin("quvi", "query", p);
   qp = quvi_playlist_new(qps->q, (const gchar*) p);
+  lutil_trace_end("quvi", "query");
   if (quvi_ok(qps->q) == QUVI_TRUE)
     qps->activity(qps, qp, p);
   else
@@ -52,12 +54,21 @@ void lutil_query_media(gpointer p, gpointer userdata)
 {
   lutil_query_properties_t qps;
   quvi_media_t qm;
+  GTimer *t;
 
   qps = (lutil_query_properties_t) userdata;
   if (qps->exit_status != EXIT_SUCCESS)
     return;
 
+  lutil_trace_begin("quvi", "query", p);
+  t = g_timer_new();
   qm = quvi_media_new(qps->q, p);
+  lutil_trace_end("quvi", "query");
+
+  lutil_metrics_add(UTIL_METRIC_RESOLVE_SECONDS, p,
+                    g_timer_elapsed(t, NULL));
+  g_timer_destroy(t);
+
   if (quvi_ok(qps->q) == QUVI_TRUE)
     qps->activity(qps, qm, p);
   else
@@ -65,6 +76,9 @@ void lutil_query_media(gpointer p, gpointer userdata)
       qps->xperr(_("libquvi: while parsing media properties: %s"),
                  quvi_errmsg(qps->q));
 
+      lutil_metrics_add(UTIL_METRIC_URLS_PROCESSED, p, 1);
+      lutil_metrics_add(UTIL_METRIC_URLS_FAILED, p, 1);
+
       qps->exit_status = EXIT_FAILURE;
     }
   quvi_media_free(qm);
@@ -79,7 +93,9 @@ void lutil_query_subtitle(gpointer p, gpointer userdata)
   if (qps->exit_status != EXIT_SUCCESS)
     return;
 
+  lutil_trace_begin("quvi", "query", p);
   qsub = quvi_subtitle_new(qps->q, p);
+  lutil_trace_end("quvi", "query");
   if (quvi_ok(qps->q) == QUVI_TRUE)
     qps->activity(qps, qsub, p);
   else
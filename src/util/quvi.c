@@ -27,6 +27,51 @@
 
 #include "lutil.h"
 
+/*
+ * - auto (libcurl default)
+ * - 1.1
+ * - 2    (HTTP/2 for https only)
+ * - 3    (HTTP/3, requires libcurl built with the support)
+ */
+
+const gchar *lutil_http_version_possible_values[] =
+{
+  "auto", "1.1", "2", "3", NULL
+};
+
+/* Map the --http-version value to CURLOPT_HTTP_VERSION. */
+static gint _set_http_version(CURL *c, const gchar *v)
+{
+  glong n;
+
+  if (v == NULL || g_strcmp0(v, "auto") == 0)
+    return (EXIT_SUCCESS);
+
+  if (g_strcmp0(v, "1.1") == 0)
+    n = CURL_HTTP_VERSION_1_1;
+#if LIBCURL_VERSION_NUM >= 0x072f00
+  else if (g_strcmp0(v, "2") == 0)
+    n = CURL_HTTP_VERSION_2TLS;
+#endif
+#if LIBCURL_VERSION_NUM >= 0x074200
+  else if (g_strcmp0(v, "3") == 0)
+    n = CURL_HTTP_VERSION_3;
+#endif
+  else
+    {
+      g_printerr(_("error: HTTP/%s is not supported by this version "
+                   "of libcurl\n"), v);
+      return (EXIT_FAILURE);
+    }
+
+  if (curl_easy_setopt(c, CURLOPT_HTTP_VERSION, n) != CURLE_OK)
+    {
+      g_printerr(_("error: HTTP/%s is not supported by libcurl\n"), v);
+      return (EXIT_FAILURE);
+    }
+  return (EXIT_SUCCESS);
+}
+
 gint lutil_quvi_init(quvi_t *q, lutil_net_opts_t o)
 {
   *q = quvi_new();
@@ -47,6 +92,10 @@ gint lutil_quvi_init(quvi_t *q, lutil_net_opts_t o)
           return (EXIT_FAILURE);
         }
       curl_easy_setopt(c, CURLOPT_VERBOSE, o->verbose);
+      lutil_curl_share_attach(c);
+
+      if (_set_http_version(c, o->http_version) != EXIT_SUCCESS)
+        return (EXIT_FAILURE);
 
       curl_easy_setopt(c, CURLOPT_MAX_RECV_SPEED_LARGE,
                        (curl_off_t) o->throttle_ki_s * 1024);
@@ -0,0 +1,296 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A token bucket shared by all of the media transfers of the process.
+ * The rate (bytes/s) is either --throttle, the rate of the matching
+ * --throttle-schedule window, or the value read from --throttle-file,
+ * in the ascending order of precedence. The rate is re-evaluated once
+ * a second, so that the file may be edited while a batch is running.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+struct window_s
+{
+  gint start; /* minutes since midnight */
+  gint end;
+  gdouble rate;
+};
+
+typedef struct window_s *window_t;
+
+static struct
+{
+  gchar *control_fpath;
+  gboolean enabled;
+  GSList *schedule;
+  gint64 checked;
+  gdouble tokens;
+  gdouble rate; /* 0 = unlimited */
+  gdouble base;
+  gint64 last;
+  GMutex lock;
+} r;
+
+/* Parse "HH:MM" to minutes since midnight. */
+static gboolean _parse_time(const gchar *s, gint *m)
+{
+  guint h, n;
+  gchar c;
+
+  if (sscanf(s, "%2u:%2u%c", &h, &n, &c) != 2 || h >23 || n >59)
+    return (FALSE);
+
+  *m = h*60 + n;
+  return (TRUE);
+}
+
+/* Parse "HH:MM-HH:MM=RATE" to a window. */
+static window_t _parse_window(const gchar *s)
+{
+  gchar **v, **t;
+  window_t w;
+  gchar *e;
+
+  w = g_new0(struct window_s, 1);
+  v = g_strsplit(s, "=", 2);
+  t = NULL;
+
+  if (g_strv_length(v) != 2)
+    goto fail;
+
+  t = g_strsplit(g_strstrip(v[0]), "-", 2);
+
+  if (g_strv_length(t) != 2
+      || _parse_time(g_strstrip(t[0]), &w->start) == FALSE
+      || _parse_time(g_strstrip(t[1]), &w->end) == FALSE)
+    {
+      goto fail;
+    }
+
+  w->rate = g_ascii_strtod(g_strstrip(v[1]), &e);
+  if (*e != '\0' || *v[1] == '\0' || w->rate <0)
+    goto fail;
+
+  w->rate *= 1024;
+
+  g_strfreev(t);
+  g_strfreev(v);
+  return (w);
+
+fail:
+  g_strfreev(t);
+  g_strfreev(v);
+  g_free(w);
+  return (NULL);
+}
+
+static gint _parse_schedule(const gchar *s, const lutil_cb_printerr xperr)
+{
+  gchar **v;
+  gint i, rc;
+
+  rc = EXIT_SUCCESS;
+  v = g_strsplit(s, ",", 0);
+
+  for (i=0; v[i] != NULL && rc == EXIT_SUCCESS; ++i)
+    {
+      window_t w = _parse_window(v[i]);
+      if (w == NULL)
+        {
+          xperr(_("invalid throttle schedule window: `%s'"), v[i]);
+          rc = EXIT_FAILURE;
+        }
+      else
+        r.schedule = g_slist_append(r.schedule, w);
+    }
+  g_strfreev(v);
+  return (rc);
+}
+
+/* Return TRUE if the minute m falls within the window w. */
+static gboolean _in_window(const window_t w, const gint m)
+{
+  if (w->start <= w->end)
+    return (m >= w->start && m < w->end);
+  return (m >= w->start || m < w->end); /* Wraps past midnight. */
+}
+
+static gdouble _scheduled_rate()
+{
+  GDateTime *t;
+  gdouble rate;
+  GSList *curr;
+  gint m;
+
+  t = g_date_time_new_now_local();
+  m = g_date_time_get_hour(t)*60 + g_date_time_get_minute(t);
+  g_date_time_unref(t);
+
+  rate = r.base;
+  for (curr=r.schedule; curr != NULL; curr=g_slist_next(curr))
+    {
+      window_t w = (window_t) curr->data;
+      if (_in_window(w, m) == TRUE)
+        {
+          rate = w->rate;
+          break;
+        }
+    }
+  return (rate);
+}
+
+/* Read the rate (Ki/s) from the control file, if it exists. */
+static gboolean _control_rate(gdouble *rate)
+{
+  gchar *c, *e;
+  gdouble v;
+
+  if (r.control_fpath == NULL)
+    return (FALSE);
+
+  if (g_file_get_contents(r.control_fpath, &c, NULL, NULL) == FALSE)
+    return (FALSE);
+
+  g_strstrip(c);
+  v = g_ascii_strtod(c, &e);
+
+  if (*c == '\0' || *e != '\0' || v <0)
+    {
+      g_free(c);
+      return (FALSE);
+    }
+  g_free(c);
+
+  *rate = v*1024;
+  return (TRUE);
+}
+
+static void _update_rate(const gint64 now)
+{
+  gdouble rate;
+
+  if (_control_rate(&rate) == FALSE)
+    rate = _scheduled_rate();
+
+  if (rate != r.rate)
+    {
+      r.tokens = 0; /* Forget the debt accrued at the previous rate. */
+      r.rate = rate;
+    }
+  r.checked = now;
+}
+
+gint lutil_ratelimit_init(const gint rate_ki_s, const gchar *schedule,
+                          const gchar *control_fpath,
+                          const lutil_cb_printerr xperr)
+{
+  g_assert(r.enabled == FALSE);
+  g_assert(xperr != NULL);
+  g_assert(rate_ki_s >= 0);
+
+  memset(&r, 0, sizeof(r));
+
+  if (schedule != NULL && _parse_schedule(schedule, xperr) != EXIT_SUCCESS)
+    {
+      lutil_ratelimit_close();
+      return (EXIT_FAILURE);
+    }
+
+  r.control_fpath = g_strdup(control_fpath);
+  r.base = rate_ki_s * 1024;
+
+  r.enabled = (r.base >0 || r.schedule != NULL || r.control_fpath != NULL)
+              ? TRUE
+              : FALSE;
+
+  if (r.enabled == TRUE)
+    {
+      g_mutex_init(&r.lock);
+      r.last = g_get_monotonic_time();
+      _update_rate(r.last);
+    }
+  return (EXIT_SUCCESS);
+}
+
+/*
+ * Take n bytes from the bucket, sleep if the bucket runs dry. The bucket
+ * may go into debt: the next callers wait for it to be paid first, which
+ * keeps the sum of the concurrent transfers at the rate.
+ */
+void lutil_ratelimit_consume(const gsize n)
+{
+  gint64 now, wait;
+
+  if (r.enabled == FALSE)
+    return;
+
+  g_mutex_lock(&r.lock);
+
+  now = g_get_monotonic_time();
+  if (now - r.checked >= G_TIME_SPAN_SECOND)
+    _update_rate(now);
+
+  if (r.rate == 0)
+    {
+      r.last = now;
+      g_mutex_unlock(&r.lock);
+      return;
+    }
+
+  r.tokens += (now - r.last) * r.rate / G_TIME_SPAN_SECOND;
+  r.last = now;
+
+  if (r.tokens > r.rate) /* Allow a burst of up to a second. */
+    r.tokens = r.rate;
+
+  r.tokens -= n;
+
+  wait = (r.tokens <0)
+         ? (gint64) (-r.tokens * G_TIME_SPAN_SECOND / r.rate)
+         : 0;
+
+  g_mutex_unlock(&r.lock);
+
+  if (wait >0)
+    g_usleep(wait);
+}
+
+void lutil_ratelimit_close()
+{
+  if (r.enabled == TRUE)
+    g_mutex_clear(&r.lock);
+
+  lutil_slist_free_full(r.schedule, (GFunc) g_free);
+  g_free(r.control_fpath);
+
+  memset(&r, 0, sizeof(r));
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -0,0 +1,115 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A bounded, lock-free byte ring for a single producer and a single
+ * consumer thread. The producer advances 'head', the consumer 'tail';
+ * both are free running counters, the size is a power of two.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+struct lutil_ring_s
+{
+  gchar *buf;
+  guint size;
+  gint head; /* bytes written, by the producer */
+  gint tail; /* bytes read, by the consumer */
+};
+
+lutil_ring_t lutil_ring_new(const gsize size)
+{
+  lutil_ring_t r;
+  guint n;
+
+  /* The 32-bit counters wrap, the fill must fit: 1 GiB at most. */
+  g_assert(size >0 && size <= (gsize) 1 << 30);
+
+  for (n=1; n < size; n <<= 1);
+
+  r = g_new0(struct lutil_ring_s, 1);
+  r->buf = g_malloc(n);
+  r->size = n;
+
+  return (r);
+}
+
+gsize lutil_ring_size(const lutil_ring_t r)
+{
+  return (r->size);
+}
+
+gsize lutil_ring_fill(const lutil_ring_t r)
+{
+  return ((guint) g_atomic_int_get(&r->head)
+          - (guint) g_atomic_int_get(&r->tail));
+}
+
+/* Producer: copy up to n bytes, return the number of bytes copied. */
+gsize lutil_ring_push(lutil_ring_t r, gconstpointer p, gsize n)
+{
+  guint h, i, k;
+
+  h = (guint) r->head;
+  n = MIN(n, r->size - lutil_ring_fill(r));
+
+  i = h & (r->size-1);
+  k = MIN(n, r->size - i);
+
+  memcpy(r->buf+i, p, k);
+  memcpy(r->buf, (const gchar*) p + k, n-k);
+
+  g_atomic_int_set(&r->head, (gint) (h + n)); /* Publish. */
+  return (n);
+}
+
+/* Consumer: return the number of contiguous bytes readable at *p. */
+gsize lutil_ring_peek(const lutil_ring_t r, gconstpointer *p)
+{
+  guint i, n;
+
+  n = lutil_ring_fill(r);
+  i = (guint) r->tail & (r->size-1);
+
+  *p = r->buf+i;
+  return (MIN(n, r->size - i));
+}
+
+/* Consumer: release n bytes returned by lutil_ring_peek. */
+void lutil_ring_consume(lutil_ring_t r, const gsize n)
+{
+  g_atomic_int_set(&r->tail, (gint) ((guint) r->tail + n));
+}
+
+void lutil_ring_free(lutil_ring_t r)
+{
+  if (r == NULL)
+    return;
+
+  g_free(r->buf);
+  g_free(r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
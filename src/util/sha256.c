@@ -0,0 +1,293 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SHA-256 (FIPS 180-4) computed as the data arrives. Unlike GChecksum,
+ * the state may be saved to and restored from a string, so that the
+ * hash of a resumed transfer can be continued from the sidecar.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n.h>
+
+#include "lutil.h"
+
+static const guint32 k[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x,n) (((x) >> (n)) | ((x) << (32-(n))))
+
+static void _transform(lutil_sha256_t s, const guchar *b)
+{
+  guint32 a, c, d, e, f, g, h, t1, t2, w[64], bb;
+  gint i;
+
+  for (i=0; i<16; ++i, b+=4)
+    w[i] = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+
+  for (; i<64; ++i)
+    {
+      const guint32 s0 = ROR(w[i-15],7) ^ ROR(w[i-15],18) ^ (w[i-15] >> 3);
+      const guint32 s1 = ROR(w[i-2],17) ^ ROR(w[i-2],19) ^ (w[i-2] >> 10);
+      w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+  a = s->h[0];
+  bb = s->h[1];
+  c = s->h[2];
+  d = s->h[3];
+  e = s->h[4];
+  f = s->h[5];
+  g = s->h[6];
+  h = s->h[7];
+
+  for (i=0; i<64; ++i)
+    {
+      t1 = h + (ROR(e,6) ^ ROR(e,11) ^ ROR(e,25)) + ((e & f) ^ (~e & g))
+           + k[i] + w[i];
+      t2 = (ROR(a,2) ^ ROR(a,13) ^ ROR(a,22))
+           + ((a & bb) ^ (a & c) ^ (bb & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = bb;
+      bb = a;
+      a = t1 + t2;
+    }
+
+  s->h[0] += a;
+  s->h[1] += bb;
+  s->h[2] += c;
+  s->h[3] += d;
+  s->h[4] += e;
+  s->h[5] += f;
+  s->h[6] += g;
+  s->h[7] += h;
+}
+
+void lutil_sha256_init(lutil_sha256_t s)
+{
+  static const guint32 h0[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+  g_assert(s != NULL);
+
+  memset(s, 0, sizeof(struct lutil_sha256_s));
+  memcpy(s->h, h0, sizeof(h0));
+}
+
+void lutil_sha256_update(lutil_sha256_t s, gconstpointer p, gsize n)
+{
+  const guchar *b = (const guchar*) p;
+  gsize used;
+
+  g_assert(s != NULL);
+
+  used = s->n % 64;
+  s->n += n;
+
+  if (used >0)
+    {
+      const gsize m = MIN(64-used, n);
+
+      memcpy(s->buf+used, b, m);
+      b += m;
+      n -= m;
+
+      if (used+m <64)
+        return;
+
+      _transform(s, s->buf);
+    }
+
+  for (; n >= 64; n-=64, b+=64)
+    _transform(s, b);
+
+  if (n >0)
+    memcpy(s->buf, b, n);
+}
+
+/* Return the hex digest, the state is left as it is (g_free). */
+gchar *lutil_sha256_hex(const lutil_sha256_t s)
+{
+  struct lutil_sha256_s t;
+  guchar pad[72];
+  guint64 bits;
+  GString *r;
+  gsize n;
+  gint i;
+
+  g_assert(s != NULL);
+
+  memcpy(&t, s, sizeof(struct lutil_sha256_s));
+  bits = t.n * 8;
+
+  n = (t.n % 64 < 56) ? 56 - t.n % 64 : 120 - t.n % 64;
+
+  memset(pad, 0, sizeof(pad));
+  pad[0] = 0x80;
+
+  for (i=0; i<8; ++i)
+    pad[n+i] = (guchar) (bits >> (56 - i*8));
+
+  lutil_sha256_update(&t, pad, n+8);
+
+  r = g_string_new(NULL);
+  for (i=0; i<8; ++i)
+    g_string_append_printf(r, "%08x", t.h[i]);
+
+  return (g_string_free(r, FALSE));
+}
+
+/* Return the state as a string: "<h0..h7>:<n>:<buffered bytes>". */
+gchar *lutil_sha256_state_to_str(const lutil_sha256_t s)
+{
+  GString *r;
+  guint i;
+
+  g_assert(s != NULL);
+
+  r = g_string_new(NULL);
+
+  for (i=0; i<8; ++i)
+    g_string_append_printf(r, "%08x", s->h[i]);
+
+  g_string_append_printf(r, ":%" G_GUINT64_FORMAT ":", s->n);
+
+  for (i=0; i < s->n % 64; ++i)
+    g_string_append_printf(r, "%02x", s->buf[i]);
+
+  return (g_string_free(r, FALSE));
+}
+
+gboolean lutil_sha256_state_from_str(lutil_sha256_t s, const gchar *str)
+{
+  gchar **v;
+  gsize i, l;
+  gboolean r;
+
+  g_assert(s != NULL);
+
+  if (str == NULL)
+    return (FALSE);
+
+  memset(s, 0, sizeof(struct lutil_sha256_s));
+
+  v = g_strsplit(str, ":", 3);
+  r = FALSE;
+
+  if (g_strv_length(v) != 3 || strlen(v[0]) != 64)
+    goto out;
+
+  for (i=0; i<8; ++i)
+    {
+      gchar h[9];
+
+      memcpy(h, v[0]+i*8, 8);
+      h[8] = '\0';
+
+      s->h[i] = (guint32) g_ascii_strtoull(h, NULL, 16);
+    }
+
+  s->n = g_ascii_strtoull(v[1], NULL, 10);
+  l = strlen(v[2]);
+
+  if (l != (s->n % 64) * 2)
+    goto out;
+
+  for (i=0; i<l; i+=2)
+    {
+      const gint hi = g_ascii_xdigit_value(v[2][i]);
+      const gint lo = g_ascii_xdigit_value(v[2][i+1]);
+
+      if (hi <0 || lo <0)
+        goto out;
+
+      s->buf[i/2] = (guchar) ((hi << 4) | lo);
+    }
+  r = TRUE;
+
+out:
+  g_strfreev(v);
+  return (r);
+}
+
+static GMutex manifest_lock;
+
+/* Append the digest of the file to the manifest (sha256sum format). */
+gint lutil_sha256_manifest_append(const gchar *fpath, const gchar *digest,
+                                  const gchar *file,
+                                  const lutil_cb_printerr xperr)
+{
+  FILE *f;
+  gint r;
+
+  g_assert(digest != NULL);
+  g_assert(xperr != NULL);
+  g_assert(fpath != NULL);
+  g_assert(file != NULL);
+
+  g_mutex_lock(&manifest_lock);
+
+  r = EXIT_FAILURE;
+  f = g_fopen(fpath, "a");
+
+  if (f != NULL)
+    {
+      if (fprintf(f, "%s  %s\n", digest, file) >0)
+        r = EXIT_SUCCESS;
+      if (fclose(f) != 0)
+        r = EXIT_FAILURE;
+    }
+
+  if (r != EXIT_SUCCESS)
+    {
+      gchar *e = lutil_strerror();
+      xperr(_("while writing to file: %s: %s"), fpath, e);
+      g_free(e);
+    }
+
+  g_mutex_unlock(&manifest_lock);
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
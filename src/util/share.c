@@ -0,0 +1,134 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A libcurl share object used by the curl handles of all the quvi_t
+ * handles (see lutil_quvi_init): the DNS cache, the TLS sessions and
+ * the connection cache are shared across the handles, so that e.g. the
+ * metainfo request, the page fetches and the media transfers to the
+ * same host reuse the same connections.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib/gi18n.h>
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "lutil.h"
+
+static struct
+{
+  GMutex lock[CURL_LOCK_DATA_LAST];
+  gint new_connects;
+  gint requests;
+  CURLSH *sh;
+} s;
+
+static void _lock(CURL *c, curl_lock_data d, curl_lock_access a,
+                  gpointer p)
+{
+  g_mutex_lock(&s.lock[d]);
+}
+
+static void _unlock(CURL *c, curl_lock_data d, gpointer p)
+{
+  g_mutex_unlock(&s.lock[d]);
+}
+
+static gpointer _share_new(gpointer p)
+{
+  guint i;
+
+  s.sh = curl_share_init();
+  if (s.sh == NULL)
+    return (NULL);
+
+  for (i=0; i<CURL_LOCK_DATA_LAST; ++i)
+    g_mutex_init(&s.lock[i]);
+
+  curl_share_setopt(s.sh, CURLSHOPT_LOCKFUNC, _lock);
+  curl_share_setopt(s.sh, CURLSHOPT_UNLOCKFUNC, _unlock);
+
+  curl_share_setopt(s.sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x071700
+  curl_share_setopt(s.sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x073900
+  curl_share_setopt(s.sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  return (s.sh);
+}
+
+/* Attach the curl handle to the share object, create it if needed. */
+void lutil_curl_share_attach(gpointer c)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once(&once, _share_new, NULL);
+
+  if (s.sh != NULL)
+    curl_easy_setopt(c, CURLOPT_SHARE, s.sh);
+}
+
+/* Account the connection (re)use of the last request made with c. */
+void lutil_curl_share_account(gpointer c)
+{
+  glong n = 0;
+
+  curl_easy_getinfo(c, CURLINFO_NUM_CONNECTS, &n);
+
+  g_atomic_int_add(&s.new_connects, (gint) n);
+  g_atomic_int_inc(&s.requests);
+}
+
+/*
+ * Release the share object. The handles attached to it must have been
+ * released already. Print the connection reuse rate in the debug
+ * verbosity level.
+ */
+void lutil_curl_share_free()
+{
+  guint i;
+
+  if (s.sh == NULL)
+    return;
+
+  if (lutil_get_verbosity_level() == UTIL_VERBOSITY_LEVEL_DEBUG
+      && s.requests >0)
+    {
+      const gint reused = MAX(s.requests - s.new_connects, 0);
+
+      g_printerr(_("debug: connections: %d requests, %d new "
+                   "connections, %.0f%% reused\n"),
+                 s.requests, s.new_connects, 100.0*reused/s.requests);
+    }
+
+  if (curl_share_cleanup(s.sh) != CURLSHE_OK)
+    return; /* Still in use. */
+
+  for (i=0; i<CURL_LOCK_DATA_LAST; ++i)
+    g_mutex_clear(&s.lock[i]);
+
+  s.sh = NULL;
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -0,0 +1,284 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The sidecar (<file>.quvi) records the HTTP validators (ETag,
+ * Last-Modified) and the content length of the media stream saved to
+ * the file, and an Adler-32 checksum of the bytes written so far. It is
+ * used to tell whether a partial file may be resumed, and whether a
+ * complete one is still the same as the remote one.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n.h>
+
+#include "lutil.h"
+
+static const gchar g_sidecar[] = "quvi";
+
+#define ADLER_MOD 65521
+
+guint32 lutil_adler32(const guint32 adler, gconstpointer p, gsize n)
+{
+  const guchar *b = (const guchar*) p;
+  guint32 s1, s2;
+
+  s1 = adler & 0xffff;
+  s2 = (adler >> 16) & 0xffff;
+
+  while (n >0)
+    {
+      /* 5552 is the most that can be summed without an overflow. */
+      gsize k = (n < 5552) ? n:5552;
+      n -= k;
+      while (k-- >0)
+        {
+          s1 += *b++;
+          s2 += s1;
+        }
+      s1 %= ADLER_MOD;
+      s2 %= ADLER_MOD;
+    }
+  return ((s2 << 16) | s1);
+}
+
+static gchar *_sidecar_fpath(const gchar *fpath)
+{
+  return (g_strconcat(fpath, ".quvi", NULL));
+}
+
+void lutil_sidecar_clear(lutil_sidecar_t s)
+{
+  g_assert(s != NULL);
+
+  g_free(s->last_modified);
+  g_free(s->sha256);
+  g_free(s->etag);
+
+  memset(s, 0, sizeof(struct lutil_sidecar_s));
+  s->adler32 = 1;
+}
+
+static gdouble _get_double(GKeyFile *kf, const gchar *k)
+{
+  gchar *s;
+  gdouble d;
+
+  s = g_key_file_get_string(kf, g_sidecar, k, NULL);
+  d = (s != NULL) ? g_ascii_strtod(s, NULL) : 0;
+  g_free(s);
+
+  return (d);
+}
+
+/* Read the sidecar of the file at fpath, if there is one. */
+gint lutil_sidecar_read(const gchar *fpath, lutil_sidecar_t s)
+{
+  GKeyFile *kf;
+  gchar *p, *a;
+  gint r;
+
+  g_assert(fpath != NULL);
+  g_assert(s != NULL);
+
+  lutil_sidecar_clear(s);
+
+  kf = g_key_file_new();
+  p = _sidecar_fpath(fpath);
+  r = EXIT_FAILURE;
+
+  if (g_key_file_load_from_file(kf, p, G_KEY_FILE_NONE, NULL) == TRUE
+      && g_key_file_has_group(kf, g_sidecar) == TRUE)
+    {
+      s->last_modified = g_key_file_get_string(kf, g_sidecar,
+                                               "last-modified", NULL);
+      s->etag = g_key_file_get_string(kf, g_sidecar, "etag", NULL);
+      s->sha256 = g_key_file_get_string(kf, g_sidecar, "sha256", NULL);
+
+      s->complete = g_key_file_get_boolean(kf, g_sidecar, "complete", NULL);
+      s->content_bytes = _get_double(kf, "content-length");
+      s->bytes = _get_double(kf, "bytes");
+
+      a = g_key_file_get_string(kf, g_sidecar, "adler32", NULL);
+      if (a != NULL)
+        {
+          s->adler32 = (guint32) g_ascii_strtoull(a, NULL, 16);
+          r = EXIT_SUCCESS;
+        }
+      g_free(a);
+    }
+
+  g_key_file_free(kf);
+  g_free(p);
+
+  if (r != EXIT_SUCCESS)
+    lutil_sidecar_clear(s);
+
+  return (r);
+}
+
+/* Write the sidecar of the file at fpath, replace the existing one. */
+gint lutil_sidecar_write(const gchar *fpath, const lutil_sidecar_t s,
+                         const lutil_cb_printerr xperr)
+{
+  GError *e;
+  GKeyFile *kf;
+  gchar *p, *d;
+  gint r;
+
+  g_assert(fpath != NULL);
+  g_assert(xperr != NULL);
+  g_assert(s != NULL);
+
+  kf = g_key_file_new();
+
+  if (s->etag != NULL)
+    g_key_file_set_string(kf, g_sidecar, "etag", s->etag);
+
+  if (s->last_modified != NULL)
+    {
+      g_key_file_set_string(kf, g_sidecar, "last-modified",
+                            s->last_modified);
+    }
+
+  d = g_strdup_printf("%.0f", s->content_bytes);
+  g_key_file_set_string(kf, g_sidecar, "content-length", d);
+  g_free(d);
+
+  d = g_strdup_printf("%.0f", s->bytes);
+  g_key_file_set_string(kf, g_sidecar, "bytes", d);
+  g_free(d);
+
+  d = g_strdup_printf("%08x", s->adler32);
+  g_key_file_set_string(kf, g_sidecar, "adler32", d);
+  g_free(d);
+
+  if (s->sha256 != NULL)
+    g_key_file_set_string(kf, g_sidecar, "sha256", s->sha256);
+
+  g_key_file_set_boolean(kf, g_sidecar, "complete", s->complete);
+
+  d = g_key_file_to_data(kf, NULL, NULL);
+  p = _sidecar_fpath(fpath);
+  r = EXIT_SUCCESS;
+  e = NULL;
+
+  if (g_file_set_contents(p, d, -1, &e) == FALSE)
+    {
+      xperr(_("while writing file: %s"), e->message);
+      g_error_free(e);
+      r = EXIT_FAILURE;
+    }
+
+  g_key_file_free(kf);
+  g_free(p);
+  g_free(d);
+
+  return (r);
+}
+
+/*
+ * Continue the SHA-256 from the state in the sidecar if it covers the
+ * first s->bytes, otherwise start over. Return the offset to continue
+ * hashing the file from.
+ */
+static gdouble _sha256_from(const lutil_sidecar_t s, lutil_sha256_t sha)
+{
+  if (lutil_sha256_state_from_str(sha, s->sha256) == TRUE
+      && sha->n == (guint64) s->bytes)
+    {
+      return (s->bytes);
+    }
+  lutil_sha256_init(sha);
+  return (0);
+}
+
+/*
+ * Check that the first s->bytes of the file at fpath still match the
+ * checksum in the sidecar. Return the checksum and the length of the
+ * whole file, to continue from when the file is appended to. The
+ * SHA-256 of the whole file is returned in sha, unless NULL.
+ */
+gint lutil_sidecar_verify(const gchar *fpath, const lutil_sidecar_t s,
+                          guint32 *adler, gdouble *bytes,
+                          lutil_sha256_t sha)
+{
+  guchar b[64*1024];
+  gboolean matched;
+  gdouble n, o;
+  guint32 a;
+  gsize k;
+  FILE *f;
+
+  g_assert(adler != NULL);
+  g_assert(bytes != NULL);
+  g_assert(fpath != NULL);
+  g_assert(s != NULL);
+
+  f = g_fopen(fpath, "rb");
+  if (f == NULL)
+    return (EXIT_FAILURE);
+
+  matched = (s->bytes ==0) ? TRUE:FALSE;
+  o = (sha != NULL) ? _sha256_from(s, sha) : 0;
+  a = 1;
+  n = 0;
+
+  while ((k = fread(b, 1, sizeof(b), f)) >0)
+    {
+      if (sha != NULL && n+k > o)
+        {
+          const gsize m = (n < o) ? (gsize) (o - n) : 0;
+          lutil_sha256_update(sha, b+m, k-m);
+        }
+
+      /* Stop at s->bytes exactly, for the comparison. */
+      if (matched == FALSE && n+k >= s->bytes)
+        {
+          const gsize m = (gsize) (s->bytes - n);
+
+          a = lutil_adler32(a, b, m);
+          if (a != s->adler32)
+            break;
+
+          a = lutil_adler32(a, b+m, k-m);
+          matched = TRUE;
+        }
+      else
+        a = lutil_adler32(a, b, k);
+      n += k;
+    }
+  fclose(f);
+
+  if (matched == FALSE)
+    return (EXIT_FAILURE);
+
+  *adler = a;
+  *bytes = n;
+
+  return (EXIT_SUCCESS);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
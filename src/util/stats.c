@@ -0,0 +1,216 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <quvi.h>
+#include <curl/curl.h>
+
+#include "lutil.h"
+
+/* Collect the timing of the last request made with the curl handle. */
+void lutil_curl_stats_from(gpointer c, lutil_curl_stats_t s)
+{
+#if LIBCURL_VERSION_NUM >= 0x073700
+  curl_off_t speed, size;
+#endif
+
+  g_assert(c != NULL);
+  g_assert(s != NULL);
+
+  memset(s, 0, sizeof(struct lutil_curl_stats_s));
+
+  curl_easy_getinfo(c, CURLINFO_NAMELOOKUP_TIME, &s->namelookup_time);
+  curl_easy_getinfo(c, CURLINFO_CONNECT_TIME, &s->connect_time);
+  curl_easy_getinfo(c, CURLINFO_APPCONNECT_TIME, &s->appconnect_time);
+  curl_easy_getinfo(c, CURLINFO_STARTTRANSFER_TIME, &s->starttransfer_time);
+  curl_easy_getinfo(c, CURLINFO_TOTAL_TIME, &s->total_time);
+#if LIBCURL_VERSION_NUM >= 0x073700
+  speed = 0;
+  size = 0;
+  curl_easy_getinfo(c, CURLINFO_SPEED_DOWNLOAD_T, &speed);
+  curl_easy_getinfo(c, CURLINFO_SIZE_DOWNLOAD_T, &size);
+  s->speed_download = speed;
+  s->size_download = size;
+#else
+  curl_easy_getinfo(c, CURLINFO_SPEED_DOWNLOAD, &s->speed_download);
+  curl_easy_getinfo(c, CURLINFO_SIZE_DOWNLOAD, &s->size_download);
+#endif
+  curl_easy_getinfo(c, CURLINFO_REDIRECT_COUNT, &s->redirect_count);
+  curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &s->response_code);
+  curl_easy_getinfo(c, CURLINFO_EFFECTIVE_URL, &s->url);
+#if LIBCURL_VERSION_NUM >= 0x073200
+  curl_easy_getinfo(c, CURLINFO_HTTP_VERSION, &s->http_version);
+#endif
+}
+
+/* Return the protocol name of the CURLINFO_HTTP_VERSION value. */
+const gchar *lutil_curl_http_version_str(const glong v)
+{
+  switch (v)
+    {
+    case CURL_HTTP_VERSION_1_0:
+      return ("1.0");
+    case CURL_HTTP_VERSION_1_1:
+      return ("1.1");
+#if LIBCURL_VERSION_NUM >= 0x072100
+    case CURL_HTTP_VERSION_2_0:
+      return ("2");
+#endif
+#if LIBCURL_VERSION_NUM >= 0x074200
+    case CURL_HTTP_VERSION_3:
+      return ("3");
+#endif
+    default:
+      break;
+    }
+  return ("unknown");
+}
+
+/* Append the JSON string value of s to the buffer. */
+static void _append_json_str(GString *b, const gchar *s)
+{
+  g_string_append_c(b, '"');
+  for (; s != NULL && *s != '\0'; ++s)
+    {
+      switch (*s)
+        {
+        case '"':
+          g_string_append(b, "\\\"");
+          break;
+        case '\\':
+          g_string_append(b, "\\\\");
+          break;
+        default:
+          if ((guchar) *s <0x20)
+            g_string_append_printf(b, "\\u%04x", (guchar) *s);
+          else
+            g_string_append_c(b, *s);
+          break;
+        }
+    }
+  g_string_append_c(b, '"');
+}
+
+static GMutex stats_lock;
+
+/*
+ * Append the stats as a record (a JSON object on a line of its own) to
+ * the file at fpath. The kind is either "head" (HTTP metainfo query) or
+ * "get" (media transfer), file and w may be NULL. The write buffer
+ * stats (w) are included if --write-buffer was used.
+ */
+gint lutil_stats_write(const gchar *fpath, const gchar *kind,
+                       const gchar *file, const lutil_curl_stats_t s,
+                       const lutil_iow_stats_t w,
+                       const lutil_cb_printerr xperr)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE], t[G_ASCII_DTOSTR_BUF_SIZE];
+  GString *b;
+  FILE *f;
+  gint r;
+
+  g_assert(fpath != NULL);
+  g_assert(kind != NULL);
+  g_assert(xperr != NULL);
+  g_assert(s != NULL);
+
+  b = g_string_new("{\"kind\":");
+  _append_json_str(b, kind);
+
+  g_string_append(b, ",\"url\":");
+  _append_json_str(b, s->url);
+
+  if (file != NULL)
+    {
+      g_string_append(b, ",\"file\":");
+      _append_json_str(b, file);
+    }
+
+  /* Not the locale decimal point. */
+#define _append_d(n)\
+  g_string_append_printf(b, ",\"" #n "\":%s",\
+                         g_ascii_formatd(buf, sizeof(buf), "%.6f", s->n))
+
+  _append_d(namelookup_time);
+  _append_d(connect_time);
+  _append_d(appconnect_time);
+  _append_d(starttransfer_time);
+  _append_d(total_time);
+  _append_d(speed_download);
+  _append_d(size_download);
+
+#undef _append_d
+
+  g_string_append_printf(b, ",\"redirect_count\":%ld,"
+                         "\"response_code\":%ld,",
+                         s->redirect_count, s->response_code);
+
+  g_string_append(b, "\"http_version\":");
+  _append_json_str(b, lutil_curl_http_version_str(s->http_version));
+
+  if (w != NULL && w->size >0)
+    {
+      g_string_append_printf(b, ",\"write_buffer_size\":%" G_GSIZE_FORMAT
+                             ",\"write_buffer_peak\":%" G_GSIZE_FORMAT
+                             ",\"write_buffer_mean\":%s"
+                             ",\"write_stalls\":%u"
+                             ",\"write_stall_time\":%s",
+                             w->size, w->fill_peak,
+                             g_ascii_formatd(buf, sizeof(buf), "%.1f",
+                                             w->fill_mean),
+                             w->stalls,
+                             g_ascii_formatd(t, sizeof(t), "%.6f",
+                                             w->stall_time));
+    }
+  g_string_append(b, "}\n");
+
+  g_mutex_lock(&stats_lock);
+
+  r = EXIT_FAILURE;
+  f = g_fopen(fpath, "a");
+
+  if (f != NULL)
+    {
+      if (fwrite(b->str, b->len, 1, f) == 1)
+        r = EXIT_SUCCESS;
+
+      if (fclose(f) !=0)
+        r = EXIT_FAILURE;
+    }
+
+  if (r != EXIT_SUCCESS)
+    {
+      gchar *e = lutil_strerror();
+      xperr(_("while writing: %s: %s"), fpath, e);
+      g_free(e);
+    }
+
+  g_mutex_unlock(&stats_lock);
+  g_string_free(b, TRUE);
+
+  return (r);
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
@@ -29,9 +29,14 @@
 static glong _support(const lutil_check_support_t css, const gchar *url,
                       const QuviSupportsType type)
 {
+  QuviBoolean r;
   glong qc;
 
-  if (quvi_supports(css->q, url, css->mode, type) == QUVI_TRUE)
+  lutil_trace_begin("quvi", "check", url);
+  r = quvi_supports(css->q, url, css->mode, type);
+  lutil_trace_end("quvi", "check");
+
+  if (r == QUVI_TRUE)
     return (QUVI_OK);
 
   qc = quvi_errcode(css->q);
@@ -0,0 +1,169 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Event tracing in the Chrome trace event format (JSON array), which
+ * e.g. Perfetto and chrome://tracing can open. Each span is a pair of
+ * "B" (begin) and "E" (end) events on the thread that recorded it.
+ *
+ * The events are written as they are recorded. The format allows the
+ * closing bracket to be missing, so that the file remains usable even
+ * if the program does not exit cleanly.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+static struct
+{
+  gint64 start;
+  gint next_tid;
+  GMutex lock;
+  FILE *file;
+  gint pid;
+} t;
+
+static GPrivate tid_key;
+
+/* Return a small ID for the calling thread, starting from 1. */
+static gint _tid()
+{
+  gint r = GPOINTER_TO_INT(g_private_get(&tid_key));
+  if (r ==0)
+    {
+      r = g_atomic_int_add(&t.next_tid, 1) +1;
+      g_private_set(&tid_key, GINT_TO_POINTER(r));
+    }
+  return (r);
+}
+
+static void _append_str(GString *b, const gchar *s)
+{
+  g_string_append_c(b, '"');
+  for (; *s != '\0'; ++s)
+    {
+      if (*s == '"' || *s == '\\')
+        g_string_append_printf(b, "\\%c", *s);
+      else if ((guchar) *s <0x20)
+        g_string_append_printf(b, "\\u%04x", (guchar) *s);
+      else
+        g_string_append_c(b, *s);
+    }
+  g_string_append_c(b, '"');
+}
+
+static void _event(const gchar ph, const gchar *cat, const gchar *name,
+                   const gchar *url)
+{
+  gint64 ts;
+  GString *b;
+
+  ts = g_get_monotonic_time() - t.start;
+  b = g_string_new("{\"name\":");
+
+  _append_str(b, name);
+  g_string_append(b, ",\"cat\":");
+  _append_str(b, cat);
+
+  g_string_append_printf(b, ",\"ph\":\"%c\",\"ts\":%"G_GINT64_FORMAT
+                         ",\"pid\":%d,\"tid\":%d", ph, ts, t.pid, _tid());
+
+  if (url != NULL)
+    {
+      g_string_append(b, ",\"args\":{\"url\":");
+      _append_str(b, url);
+      g_string_append_c(b, '}');
+    }
+  g_string_append(b, "},\n");
+
+  g_mutex_lock(&t.lock);
+  fwrite(b->str, b->len, 1, t.file);
+  g_mutex_unlock(&t.lock);
+
+  g_string_free(b, TRUE);
+}
+
+/* Begin a span on the calling thread. The url may be NULL. */
+void lutil_trace_begin(const gchar *cat, const gchar *name,
+                       const gchar *url)
+{
+  if (t.file != NULL)
+    _event('B', cat, name, url);
+}
+
+/* End the last span begun on the calling thread. */
+void lutil_trace_end(const gchar *cat, const gchar *name)
+{
+  if (t.file != NULL)
+    _event('E', cat, name, NULL);
+}
+
+gint lutil_trace_init(const gchar *fpath, const lutil_cb_printerr xperr)
+{
+  g_assert(t.file == NULL);
+  g_assert(fpath != NULL);
+  g_assert(xperr != NULL);
+
+  t.file = g_fopen(fpath, "w");
+  if (t.file == NULL)
+    {
+      gchar *e = lutil_strerror();
+      xperr(_("while opening file: %s: %s"), fpath, e);
+      g_free(e);
+      return (EXIT_FAILURE);
+    }
+
+  g_mutex_init(&t.lock);
+
+  t.start = g_get_monotonic_time();
+  t.pid = getpid();
+  _tid(); /* The main thread is 1. */
+
+  fputs("[\n", t.file);
+  fprintf(t.file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+          "\"args\":{\"name\":\"quvi\"}},\n", t.pid);
+
+  return (EXIT_SUCCESS);
+}
+
+void lutil_trace_close()
+{
+  if (t.file == NULL)
+    return;
+
+  /* A last event, so that the array ends without a trailing comma. */
+  fprintf(t.file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+          "\"tid\":1,\"args\":{\"name\":\"main\"}}\n]\n", t.pid);
+
+  fclose(t.file);
+  g_mutex_clear(&t.lock);
+
+  memset(&t, 0, sizeof(t));
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
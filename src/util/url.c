@@ -0,0 +1,191 @@
+/* quvi
+ * Copyright (C) 2013  Toni Gundogdu <legatvs@gmail.com>
+ *
+ * This file is part of quvi <http://quvi.sourceforge.net/>.
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General
+ * Public License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "lutil.h"
+
+/* Return the offset to the path component of an absolute URL. */
+static const gchar *_path_of(const gchar *url)
+{
+  const gchar *p = strstr(url, "://");
+  if (p == NULL)
+    return (NULL);
+  p += 3;
+  return (p + strcspn(p, "/?#"));
+}
+
+/* Return the lowercase host[:port] of an absolute URL, or NULL. */
+gchar *lutil_url_host(const gchar *url)
+{
+  const gchar *h, *p;
+  gchar *s, *r;
+
+  h = strstr(url, "://");
+  if (h == NULL)
+    return (NULL);
+
+  h += 3;
+  p = _path_of(url);
+
+  s = g_strndup(h, p-h);
+  if (strchr(s, '@') != NULL) /* Skip the userinfo. */
+    {
+      r = g_strdup(strrchr(s, '@')+1);
+      g_free(s);
+      s = r;
+    }
+
+  r = g_ascii_strdown(s, -1);
+  g_free(s);
+
+  if (strlen(r) ==0)
+    {
+      g_free(r);
+      r = NULL;
+    }
+  return (r);
+}
+
+/*
+ * Resolve a (possibly relative) reference against the base URL. Return
+ * an absolute http(s) URL without the fragment, or NULL.
+ */
+gchar *lutil_url_resolve(const gchar *base, const gchar *ref)
+{
+  gchar *scheme, *r, *s;
+  const gchar *p;
+
+  if (ref == NULL || strlen(ref) ==0 || ref[0] == '#')
+    return (NULL);
+
+  scheme = g_uri_parse_scheme(ref);
+  if (scheme != NULL)
+    r = g_strdup(ref);
+  else
+    {
+      scheme = g_uri_parse_scheme(base);
+      p = _path_of(base);
+
+      if (scheme == NULL || p == NULL)
+        {
+          g_free(scheme);
+          return (NULL);
+        }
+
+      if (g_str_has_prefix(ref, "//") == TRUE)
+        r = g_strdup_printf("%s:%s", scheme, ref);
+      else if (ref[0] == '/')
+        {
+          s = g_strndup(base, p-base);
+          r = g_strconcat(s, ref, NULL);
+          g_free(s);
+        }
+      else if (ref[0] == '?')
+        {
+          s = g_strndup(base, strcspn(base, "?#"));
+          r = g_strconcat(s, ref, NULL);
+          g_free(s);
+        }
+      else
+        {
+          /* Relative to the directory of the base path. */
+          gsize n = strcspn(p, "?#");
+          while (n >0 && p[n-1] != '/')
+            --n;
+          s = (n >0)
+              ? g_strndup(base, (p-base)+n)
+              : g_strconcat(base, "/", NULL);
+          r = g_strconcat(s, ref, NULL);
+          g_free(s);
+        }
+    }
+
+  s = g_ascii_strdown(scheme, -1);
+  g_free(scheme);
+
+  if (g_strcmp0(s, "http") !=0 && g_strcmp0(s, "https") !=0)
+    {
+      g_free(s);
+      g_free(r);
+      return (NULL);
+    }
+  g_free(s);
+
+  /* Drop the fragment. */
+
+  s = strchr(r, '#');
+  if (s != NULL)
+    *s = '\0';
+
+  return (r);
+}
+
+/* The short-link and embed hosts of the sites they redirect to. */
+static const gchar *site_aliases[][2] =
+{
+  {"youtu.be", "youtube.com"},
+  {"youtube-nocookie.com", "youtube.com"},
+  {"dai.ly", "dailymotion.com"},
+  {"fb.watch", "facebook.com"},
+  {"vm.tiktok.com", "tiktok.com"},
+  {NULL, NULL}
+};
+
+/* Subdomains that serve the same media as the site. */
+static const gchar *site_prefixes[] =
+{
+  "www.", "m.", "mobile.", NULL
+};
+
+/*
+ * Return the site of a host (as returned by lutil_url_host), so that
+ * e.g. www.youtube.com, m.youtube.com and youtu.be compare equal.
+ */
+gchar *lutil_url_site(const gchar *host)
+{
+  const gchar *h;
+  gint i;
+
+  g_assert(host != NULL);
+
+  h = host;
+  for (i=0; site_prefixes[i] != NULL; ++i)
+    {
+      if (g_str_has_prefix(h, site_prefixes[i]) == TRUE
+          && strchr(h+strlen(site_prefixes[i]), '.') != NULL)
+        {
+          h += strlen(site_prefixes[i]);
+          break;
+        }
+    }
+
+  for (i=0; site_aliases[i][0] != NULL; ++i)
+    {
+      if (g_strcmp0(h, site_aliases[i][0]) ==0)
+        return (g_strdup(site_aliases[i][1]));
+    }
+  return (g_strdup(h));
+}
+
+/* vim: set ts=2 sw=2 tw=72 expandtab: */
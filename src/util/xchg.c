@@ -223,6 +223,9 @@ lutil_xchg_seq_t lutil_xchg_seq_new(const lutil_xchg_seq_opts_t xopts)
   if (xopts->fpath != NULL)
     _insert(x, c, "%f", g_strdup(xopts->fpath), p);
 
+  if (xopts->checksum != NULL)
+    _insert(x, c, "%H", g_strdup(xopts->checksum), p);
+
   return (_new_regex(x, p, c));
 }
 